@@ -0,0 +1,300 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+
+#include "async.hpp"
+
+// Fields of partitions, which can go stale
+#define MALI_FIELD_REFRESHED (MALI_FIELD_PARTITION_ALL | MALI_FIELD_PROCESS_ALL)
+
+
+/*
+ * Copies fields of partition p into the staging result, as soon as they
+ * are read. Runs on the worker thread, fields are already loaded so
+ * getters issue no I/O.
+ */
+void mali_async_gpu::observe(state& s, mali_partition& p, uint32_t fields)
+{
+    lock_guard<mutex> guard(s.lock);
+    vector<mali_refresh_partition>& parts = s.staging.partitions;
+    vector<mali_refresh_partition>::iterator rp;
+
+    rp = find_if(parts.begin(), parts.end(),
+                 [&p](const mali_refresh_partition& i) { return i.partition_id == p.get_partition_id(); });
+
+    if (rp == parts.end())
+    {
+        mali_refresh_partition n = {};
+
+        n.partition_name = p.get_partition_name();
+        n.partition_id = p.get_partition_id();
+        n.stale = s.filter.get_fields() & MALI_FIELD_REFRESHED;
+        rp = parts.insert(upper_bound(parts.begin(), parts.end(), n,
+                                      [](const mali_refresh_partition& a, const mali_refresh_partition& b)
+                                      { return a.partition_id < b.partition_id; }), n);
+    }
+
+    if (fields & MALI_FIELD_STATUS)
+        rp->status = p.get_status();
+    if (fields & MALI_FIELD_SLICES)
+        rp->slices = p.get_slices();
+    if (fields & MALI_FIELD_ASSIGNED_AW)
+        rp->assigned_aw = p.get_assigned_aw();
+    if (fields & MALI_FIELD_MEMORY)
+        rp->memory_usage = p.get_memory_usage();
+    if (fields & MALI_FIELD_PM_COUNTERS)
+    {
+        rp->duty_cycle = p.get_duty_cycle();
+        rp->frequency = p.get_frequency();
+    }
+    if (fields & MALI_FIELD_PROCESS_ALL)
+    {
+        uint32_t loaded = p.get_loaded();
+        vector<mali_refresh_process> procs;
+        vector<mali_refresh_process>::iterator prev = rp->processes.begin();
+
+        // Both lists are sorted by PID, fields not read yet keep their last-good values
+        for (mali_process& i : p.get_processes(0))
+        {
+            mali_refresh_process n = { i.get_pid(), "", "", -1 };
+
+            while (prev != rp->processes.end() && prev->pid < n.pid)
+                prev++;
+            if (prev != rp->processes.end() && prev->pid == n.pid)
+                n = *prev;
+
+            if (loaded & MALI_FIELD_PROCESS_CMD)
+                n.cmd = i.get_cmd();
+            if (loaded & MALI_FIELD_PROCESS_CGROUP)
+                n.cgroup = i.get_cgroup();
+            if (loaded & MALI_FIELD_PROCESS_MEMORY)
+                n.memory_usage = i.get_memory_usage();
+
+            procs.push_back(n);
+        }
+
+        rp->processes.swap(procs);
+    }
+
+    rp->stale &= ~fields;
+}
+
+/*
+ * Worker thread, the only one doing I/O. It may stay blocked in a read
+ * for good, so it owns a reference to the state.
+ */
+void mali_async_gpu::worker(shared_ptr<state> s)
+{
+    unique_ptr<mali_gpu> gpu;
+    unique_lock<mutex> l(s->lock);
+    uint32_t fields = s->filter.get_fields();
+    uint64_t memory_usage;
+    vector<uint32_t> ids;
+
+    // Constructing the gpu reads declared fields, it counts as the first update
+    s->started = 1;
+    l.unlock();
+
+    gpu.reset(new mali_gpu(s->filter));
+    for (mali_partition& i : gpu->get_partitions())
+        observe(*s, i, i.get_loaded() & fields);
+    gpu->set_load_observer([st = s.get()](mali_partition& p, uint32_t f) { observe(*st, p, f); });
+    memory_usage = fields & MALI_FIELD_MEMORY ? gpu->get_memory_usage() : 0;
+
+    l.lock();
+
+    while (1)
+    {
+        // Publish the update, partitions gone since are dropped
+        ids.clear();
+        for (mali_partition& i : gpu->get_partitions())
+            ids.push_back(i.get_partition_id());
+        s->staging.partitions.erase(remove_if(s->staging.partitions.begin(), s->staging.partitions.end(),
+                                              [&ids](const mali_refresh_partition& i)
+                                              { return find(ids.begin(), ids.end(), i.partition_id) == ids.end(); }),
+                                    s->staging.partitions.end());
+        s->staging.memory_usage = memory_usage;
+        s->staging.epoch = s->completed = s->started;
+        s->cv.notify_all();
+
+        s->cv.wait(l, [&s] { return s->stopping || s->requested > s->started; });
+        if (s->stopping)
+            break;
+
+        s->started++;
+        for (mali_refresh_partition& i : s->staging.partitions)
+            i.stale = fields & MALI_FIELD_REFRESHED;
+        l.unlock();
+
+        gpu->update();
+        memory_usage = fields & MALI_FIELD_MEMORY ? gpu->get_memory_usage() : 0;
+
+        l.lock();
+    }
+}
+
+/*
+ * Timer thread, completes requests when their update is done or at their
+ * deadline, in deadline order. Never does I/O.
+ */
+void mali_async_gpu::timer(shared_ptr<state> s)
+{
+    unique_lock<mutex> l(s->lock);
+
+    while (1)
+    {
+        request r;
+        mali_refresh_result res;
+        bool done;
+
+        s->cv.wait(l, [&s] { return s->stopping || !s->requests.empty(); });
+        if (s->stopping)
+            break;
+
+        r = s->requests.front();
+        s->cv.wait_until(l, r.deadline, [&s, &r] {
+            return s->stopping || s->completed >= r.epoch || s->requests.front().deadline < r.deadline; });
+        if (s->stopping)
+            break;
+
+        // An earlier deadline was queued meanwhile
+        if (s->requests.front().deadline < r.deadline)
+            continue;
+
+        done = s->completed >= r.epoch;
+        s->requests.pop_front();
+
+        res = s->staging;
+        res.timed_out = !done;
+        res.stale = 0;
+
+        for (mali_refresh_partition& i : res.partitions)
+        {
+            if (done)
+                i.stale = 0;
+            // Nothing was read since the request: the update is queued behind a blocked one
+            else if (s->started < r.epoch)
+                i.stale = s->filter.get_fields() & MALI_FIELD_REFRESHED;
+            res.stale |= i.stale;
+        }
+        if (!done && s->completed == 0)
+            res.stale = s->filter.get_fields();
+
+        for (int i = 0; i < MALI_FIELD_BITS; i++)
+        {
+            if (res.stale & (1 << i))
+                s->timeouts[i]++;
+        }
+
+        l.unlock();
+        r.callback(res);
+        l.lock();
+    }
+
+    // Pending futures get a broken promise
+    s->requests.clear();
+}
+
+/*
+ * Returns how many refreshes field f missed the deadline of
+ */
+uint64_t mali_async_gpu::get_timeouts(mali_field f) const
+{
+    lock_guard<mutex> guard(s->lock);
+
+    return s->timeouts[__builtin_ctz(f)];
+}
+
+/*
+ * Requests a refresh, cb is called on an internal thread with the result
+ * once all declared fields are read or at the latest after deadline
+ */
+void mali_async_gpu::refresh(chrono::milliseconds deadline, mali_refresh_callback cb)
+{
+    lock_guard<mutex> guard(s->lock);
+    request r;
+
+    // Values must be read after the request, i.e. by the next update to start
+    r.deadline = chrono::steady_clock::now() + deadline;
+    r.epoch = s->started + 1;
+    r.callback = cb;
+
+    s->requests.insert(upper_bound(s->requests.begin(), s->requests.end(), r,
+                                   [](const request& a, const request& b) { return a.deadline < b.deadline; }), r);
+    s->requested = max(s->requested, r.epoch);
+    s->cv.notify_all();
+}
+
+/*
+ * Requests a refresh, the future is ready once all declared fields are
+ * read or at the latest after deadline
+ */
+future<mali_refresh_result> mali_async_gpu::refresh(chrono::milliseconds deadline)
+{
+    shared_ptr<promise<mali_refresh_result>> p = make_shared<promise<mali_refresh_result>>();
+
+    refresh(deadline, [p](const mali_refresh_result& r) { p->set_value(r); });
+
+    return p->get_future();
+}
+
+/*
+ * Constructor
+ * Starts reading fields of flt, the first refresh may wait for it
+ */
+mali_async_gpu::mali_async_gpu(const mali_filter& flt) : s(make_shared<state>())
+{
+    s->stopping = false;
+    s->filter = flt;
+    s->started = 0;
+    s->completed = 0;
+    s->requested = 0;
+    s->staging = mali_refresh_result();
+    fill(s->timeouts, s->timeouts + MALI_FIELD_BITS, 0);
+
+    thread(worker, s).detach();
+    timer_thread = thread(timer, s);
+}
+
+/*
+ * Destructor - waits for a callback in progress, pending requests are
+ * dropped. A worker blocked in a read exits once the read returns, it
+ * never runs callbacks.
+ */
+mali_async_gpu::~mali_async_gpu()
+{
+    {
+        lock_guard<mutex> guard(s->lock);
+
+        s->stopping = true;
+        s->cv.notify_all();
+    }
+
+    // Destroyed from a callback, the timer thread exits once it returns
+    if (timer_thread.get_id() == this_thread::get_id())
+        timer_thread.detach();
+    else
+        timer_thread.join();
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _ASYNC_H_
+#define _ASYNC_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fields.hpp"
+#include "filter.hpp"
+#include "gpu.hpp"
+
+using namespace std;
+
+struct mali_refresh_process
+{
+    pid_t pid;
+    string cmd;
+    string cgroup;
+    int64_t memory_usage; // in kB, -1 if unknown
+};
+
+/*
+ * Values of a partition, fields in stale keep their last-good values
+ */
+struct mali_refresh_partition
+{
+    string partition_name;
+    uint32_t partition_id;
+    mali_status status;
+    mali_mask slices;
+    mali_mask assigned_aw;
+    uint64_t memory_usage; // in kB
+    mali_duty_cycle duty_cycle;
+    uint64_t frequency;    // in Hz, 0 if unknown
+    vector<mali_refresh_process> processes;
+    uint32_t stale;        // MALI_FIELD_* not read before the deadline
+};
+
+struct mali_refresh_result
+{
+    uint64_t epoch;        // update the fresh values come from
+    bool timed_out;
+    uint32_t stale;        // union of stale fields of all partitions
+    uint64_t memory_usage; // in kB, stale along with partition memory
+    vector<mali_refresh_partition> partitions;
+};
+
+typedef function<void(const mali_refresh_result&)> mali_refresh_callback;
+
+/*
+ * Refreshes a mali_gpu without blocking the caller for longer than a
+ * deadline. Reads run on a worker thread; a refresh completes either when
+ * the update is done or at its deadline, whichever comes first. Fields
+ * not read by then are marked stale and keep their last-good values, a
+ * blocked read is not retried until it returns. Callbacks run on an
+ * internal timer thread, one at a time.
+ */
+class mali_async_gpu
+{
+    private:
+        struct request
+        {
+            chrono::steady_clock::time_point deadline;
+            uint64_t epoch;    // update that satisfies the request
+            mali_refresh_callback callback;
+        };
+
+        // Shared with the threads, which may outlive the object while a
+        // read is blocked
+        struct state
+        {
+            mutex lock;
+            condition_variable cv;
+            bool stopping;
+            mali_filter filter;
+            uint64_t started;  // updates started by the worker
+            uint64_t completed;
+            uint64_t requested;
+            deque<request> requests;
+            mali_refresh_result staging; // values as they are read
+            uint64_t timeouts[MALI_FIELD_BITS];
+        };
+
+        shared_ptr<state> s;
+        thread timer_thread;
+
+        static void worker(shared_ptr<state> s);
+        static void timer(shared_ptr<state> s);
+        static void observe(state& s, mali_partition& p, uint32_t fields);
+
+    public:
+        // Getter
+        uint64_t get_timeouts(mali_field f) const;
+        // Refresh
+        future<mali_refresh_result> refresh(chrono::milliseconds deadline);
+        void refresh(chrono::milliseconds deadline, mali_refresh_callback cb);
+        // Constructor / Destructor
+        mali_async_gpu(const mali_filter& flt = mali_filter());
+        ~mali_async_gpu();
+};
+
+#endif // _ASYNC_H_
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstring>
+
+#include "cgroup.hpp"
+
+
+/*
+ * Adds memory kB and count processes to cgroup totals, both may be negative
+ * Totals without any process left are removed
+ */
+void mali_cgroup_account(mali_cgroup_map& m, const char *cgroup, int64_t memory, int count)
+{
+    mali_cgroup_map::iterator it;
+
+    // Processes of an unknown cgroup are not accounted
+    if (cgroup == NULL || cgroup[0] == '\0')
+        return;
+
+    if ((it = m.find(cgroup)) == m.end())
+    {
+        if (count <= 0)
+            return;
+        it = m.emplace(cgroup, mali_cgroup_usage{0, 0}).first;
+    }
+
+    it->second.memory_usage += memory;
+    it->second.process_count += count;
+
+    if (it->second.process_count == 0)
+        m.erase(it);
+}
+
+/*
+ * Returns the totals of cgroup prefix and of all cgroups below it
+ */
+mali_cgroup_usage mali_cgroup_sum(const mali_cgroup_map& m, const string& prefix)
+{
+    mali_cgroup_usage sum = {0, 0};
+    size_t len = prefix.length();
+
+    // Ignore a trailing / so "/a/" and "/a" match the same cgroups
+    if (len > 0 && prefix[len - 1] == '/')
+        len--;
+
+    for (mali_cgroup_map::const_iterator it = m.lower_bound(prefix.substr(0, len)); it != m.end(); it++)
+    {
+        const string& cg = it->first;
+
+        if (cg.compare(0, len, prefix, 0, len) != 0)
+            break;
+
+        // Only match whole path components
+        if (cg.length() == len || cg[len] == '/')
+        {
+            sum.memory_usage += it->second.memory_usage;
+            sum.process_count += it->second.process_count;
+        }
+    }
+
+    return sum;
+}
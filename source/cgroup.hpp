@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _CGROUP_H_
+#define _CGROUP_H_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+
+using namespace std;
+
+/*
+ * GPU usage of the processes of a cgroup
+ */
+struct mali_cgroup_usage
+{
+    uint64_t memory_usage; // in kB
+    uint32_t process_count;
+};
+
+// Transparent comparison so lookups by const char * do not allocate
+typedef map<string, mali_cgroup_usage, less<>> mali_cgroup_map;
+
+void mali_cgroup_account(mali_cgroup_map& m, const char *cgroup, int64_t memory, int count);
+
+mali_cgroup_usage mali_cgroup_sum(const mali_cgroup_map& m, const string& prefix);
+
+#endif // _CGROUP_H_
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "changes.hpp"
+
+
+/*
+ * Returns a printable name for change kind
+ */
+const char *mali_change_kind_name(mali_change_kind kind)
+{
+    switch (kind)
+    {
+        case MALI_CHANGE_PARTITION_ADDED:   return "partition_added";
+        case MALI_CHANGE_PARTITION_REMOVED: return "partition_removed";
+        case MALI_CHANGE_STATUS:            return "status";
+        case MALI_CHANGE_SLICES:            return "slices";
+        case MALI_CHANGE_ASSIGNED_AW:       return "assigned_aw";
+        case MALI_CHANGE_PARTITION_MEMORY:  return "partition_memory";
+        case MALI_CHANGE_PROCESS_ARRIVED:   return "process_arrived";
+        case MALI_CHANGE_PROCESS_EXITED:    return "process_exited";
+        case MALI_CHANGE_PROCESS_MEMORY:    return "process_memory";
+        default:                            return "unknown";
+    }
+}
+
+/*
+ * Returns the number of changes of the given kind
+ */
+size_t mali_change_set::count(mali_change_kind kind) const
+{
+    size_t n = 0;
+
+    for (const mali_change& c : changes)
+    {
+        if (c.kind == kind)
+            n++;
+    }
+
+    return n;
+}
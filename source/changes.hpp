@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _CHANGES_H_
+#define _CHANGES_H_
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <sys/types.h>
+
+#include "mask.hpp"
+#include "status.hpp"
+
+using namespace std;
+
+enum mali_change_kind
+{
+    MALI_CHANGE_PARTITION_ADDED,
+    MALI_CHANGE_PARTITION_REMOVED,
+    MALI_CHANGE_STATUS,
+    MALI_CHANGE_SLICES,
+    MALI_CHANGE_ASSIGNED_AW,
+    MALI_CHANGE_PARTITION_MEMORY,
+    MALI_CHANGE_PROCESS_ARRIVED,
+    MALI_CHANGE_PROCESS_EXITED,
+    MALI_CHANGE_PROCESS_MEMORY,
+    MALI_CHANGE_KIND_COUNT
+};
+
+const char *mali_change_kind_name(mali_change_kind kind);
+
+/*
+ * A single change observed between two updates. Only the fields relevant to
+ * kind are set: old/new status for MALI_CHANGE_STATUS, old/new mask for
+ * slices and access window changes, old/new memory (in kB) for memory
+ * changes and process arrivals/exits.
+ */
+struct mali_change
+{
+    mali_change_kind kind;
+    uint32_t partition_id;
+    pid_t pid;           // process changes only, 0 otherwise
+    mali_status old_status;
+    mali_status new_status;
+    mali_mask old_mask;
+    mali_mask new_mask;
+    int64_t old_memory;
+    int64_t new_memory;
+
+    mali_change(mali_change_kind k, uint32_t part, pid_t proc_id = 0)
+        : kind(k), partition_id(part), pid(proc_id), old_status(MALI_STATUS_UNKNOWN),
+          new_status(MALI_STATUS_UNKNOWN), old_memory(0), new_memory(0) {};
+};
+
+typedef function<void(const mali_change&)> mali_change_callback;
+
+/*
+ * Changes reported by one mali_gpu::update()
+ * Clearing keeps the storage so a steady-state update does not allocate
+ */
+class mali_change_set
+{
+    private:
+        vector<mali_change> changes;
+
+    public:
+        // Getter
+        bool empty() const { return changes.empty(); };
+        size_t size() const { return changes.size(); };
+        size_t count(mali_change_kind kind) const;
+        vector<mali_change>::const_iterator begin() const { return changes.begin(); };
+        vector<mali_change>::const_iterator end() const { return changes.end(); };
+        // Setter
+        void add(const mali_change& c) { changes.push_back(c); };
+        void clear() { changes.clear(); };
+};
+
+#endif // _CHANGES_H_
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _FIELDS_H_
+#define _FIELDS_H_
+
+/*
+ * Sampled fields. Fields declared when constructing a mali_gpu are read
+ * eagerly on each update and reported in change sets; other fields are
+ * read on first access and memoized until the next update.
+ */
+enum mali_field
+{
+    // GPU
+    MALI_FIELD_NAME           = 1 << 0,
+    MALI_FIELD_DDK_VERSION    = 1 << 1,
+    MALI_FIELD_SYSTEM_MEMORY  = 1 << 2,
+    // Partition
+    MALI_FIELD_STATUS         = 1 << 3,
+    MALI_FIELD_SLICES         = 1 << 4,
+    MALI_FIELD_ASSIGNED_AW    = 1 << 5,
+    MALI_FIELD_MEMORY         = 1 << 6,
+    MALI_FIELD_PM_COUNTERS    = 1 << 11, // runtime PM and devfreq
+    // Process
+    MALI_FIELD_PROCESSES      = 1 << 7,
+    MALI_FIELD_PROCESS_CMD    = 1 << 8,
+    MALI_FIELD_PROCESS_MEMORY = 1 << 9,
+    MALI_FIELD_PROCESS_CGROUP = 1 << 10, // along with per-cgroup totals
+};
+
+#define MALI_FIELD_GPU_ALL       (MALI_FIELD_NAME | MALI_FIELD_DDK_VERSION | MALI_FIELD_SYSTEM_MEMORY)
+#define MALI_FIELD_PARTITION_ALL (MALI_FIELD_STATUS | MALI_FIELD_SLICES | MALI_FIELD_ASSIGNED_AW | MALI_FIELD_MEMORY \
+                                  | MALI_FIELD_PM_COUNTERS)
+#define MALI_FIELD_PROCESS_ALL   (MALI_FIELD_PROCESSES | MALI_FIELD_PROCESS_CMD | MALI_FIELD_PROCESS_MEMORY \
+                                  | MALI_FIELD_PROCESS_CGROUP)
+#define MALI_FIELD_ALL           (MALI_FIELD_GPU_ALL | MALI_FIELD_PARTITION_ALL | MALI_FIELD_PROCESS_ALL)
+
+// Number of field bits, e.g. for per-field counters
+#define MALI_FIELD_BITS 12
+
+static_assert(MALI_FIELD_ALL == (1 << MALI_FIELD_BITS) - 1, "MALI_FIELD_BITS must cover all fields");
+
+#endif // _FIELDS_H_
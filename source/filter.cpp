@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fnmatch.h>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+#include "filter.hpp"
+#include "utils.hpp"
+
+
+static const struct
+{
+    const char *name;
+    uint32_t fields;
+} field_names[] =
+{
+    { "gpu",            MALI_FIELD_GPU_ALL },
+    { "name",           MALI_FIELD_NAME },
+    { "ddk_version",    MALI_FIELD_DDK_VERSION },
+    { "system_memory",  MALI_FIELD_SYSTEM_MEMORY },
+    { "partition",      MALI_FIELD_PARTITION_ALL },
+    { "status",         MALI_FIELD_STATUS },
+    { "slices",         MALI_FIELD_SLICES },
+    { "access_window",  MALI_FIELD_ASSIGNED_AW },
+    { "memory",         MALI_FIELD_MEMORY },
+    { "pm",             MALI_FIELD_PM_COUNTERS },
+    { "process",        MALI_FIELD_PROCESS_ALL },
+    { "processes",      MALI_FIELD_PROCESSES },
+    { "cmd",            MALI_FIELD_PROCESS_CMD },
+    { "process_memory", MALI_FIELD_PROCESS_MEMORY },
+    { "cgroup",         MALI_FIELD_PROCESS_CGROUP },
+    { "all",            MALI_FIELD_ALL },
+};
+
+/*
+ * Returns true if partition name is sampled
+ */
+bool mali_filter::match_partition(const char *name) const
+{
+    return partitions.empty() || find(partitions.begin(), partitions.end(), name) != partitions.end();
+}
+
+/*
+ * Returns true if processes are not filtered or pid is in the PID set
+ */
+bool mali_filter::match_pid(pid_t pid) const
+{
+    return !filters_processes() || find(pids.begin(), pids.end(), pid) != pids.end();
+}
+
+/*
+ * Returns true if cmd matches one of the command line globs
+ */
+bool mali_filter::match_cmd(const char *cmd) const
+{
+    for (const string& i : cmds)
+    {
+        if (fnmatch(i.c_str(), cmd, 0) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+/*
+ * Adds partition p, by name (e.g. "mali0") or by ID (e.g. "0")
+ */
+void mali_filter::add_partition(const string& p)
+{
+    partitions.push_back(is_number(p) ? "mali" + p : p);
+}
+
+/*
+ * Adds the partitions of comma separated list
+ * Returns 0 on success
+ */
+int mali_filter::parse_partitions(const string& list)
+{
+    istringstream items(list);
+    string item;
+
+    while (getline(items, item, ','))
+    {
+        if (item.empty())
+        {
+            cout << "Invalid partition list " << list << endl;
+            return 1;
+        }
+        add_partition(item);
+    }
+
+    return 0;
+}
+
+/*
+ * Adds the PIDs and command line globs of comma separated list
+ * (e.g. "1234,python*")
+ * Returns 0 on success
+ */
+int mali_filter::parse_processes(const string& list)
+{
+    istringstream items(list);
+    string item;
+    long pid;
+
+    while (getline(items, item, ','))
+    {
+        if (item.empty())
+        {
+            cout << "Invalid process list " << list << endl;
+            return 1;
+        }
+        if (is_number(item))
+        {
+            errno = 0;
+            pid = strtol(item.c_str(), NULL, 10);
+            if (errno == ERANGE || pid <= 0 || pid > numeric_limits<pid_t>::max())
+            {
+                cout << "Invalid PID " << item << endl;
+                return 1;
+            }
+            add_pid((pid_t)pid);
+        }
+        else
+            add_cmd(item);
+    }
+
+    return 0;
+}
+
+/*
+ * Sets fields from comma separated list of field names (e.g. "status,memory")
+ * Returns 0 on success
+ */
+int mali_filter::parse_fields(const string& list)
+{
+    istringstream items(list);
+    string item;
+
+    fields = 0;
+
+    while (getline(items, item, ','))
+    {
+        size_t i;
+
+        for (i = 0; i < sizeof(field_names) / sizeof(field_names[0]); i++)
+        {
+            if (item == field_names[i].name)
+                break;
+        }
+
+        if (i == sizeof(field_names) / sizeof(field_names[0]))
+        {
+            cout << "Unknown field " << item << endl;
+            return 1;
+        }
+
+        fields |= field_names[i].fields;
+    }
+
+    return 0;
+}
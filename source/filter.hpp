@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _FILTER_H_
+#define _FILTER_H_
+
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#include "fields.hpp"
+
+using namespace std;
+
+/*
+ * Restricts sampling to a set of partitions, processes and fields.
+ * Partitions and processes are filtered out before any of their I/O is
+ * issued, except for command line globs which need the command line.
+ * An empty set matches everything.
+ */
+class mali_filter
+{
+    private:
+        vector<string> partitions; // partition names (e.g. "mali0")
+        vector<pid_t> pids;
+        vector<string> cmds;       // fnmatch(3) globs on the command line
+        uint32_t fields;
+
+    public:
+        // Getter
+        uint32_t get_fields() const { return fields; };
+        bool filters_partitions() const { return !partitions.empty(); };
+        bool filters_processes() const { return !pids.empty() || !cmds.empty(); };
+        bool filters_cmds() const { return !cmds.empty(); };
+        bool match_partition(const char *name) const;
+        bool match_pid(pid_t pid) const;
+        bool match_cmd(const char *cmd) const;
+        // Setter
+        void add_partition(const string& p);
+        void add_pid(pid_t pid) { pids.push_back(pid); };
+        void add_cmd(const string& glob) { cmds.push_back(glob); };
+        void set_fields(uint32_t f) { fields = f; };
+        int parse_partitions(const string& list);
+        int parse_processes(const string& list);
+        int parse_fields(const string& list);
+        // Constructor
+        mali_filter(uint32_t f = MALI_FIELD_ALL) : fields(f) {};
+};
+
+#endif // _FILTER_H_
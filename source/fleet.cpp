@@ -0,0 +1,623 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "fleet.hpp"
+
+
+/*
+ * Returns CLOCK_MONOTONIC in ms
+ */
+static uint64_t now_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
+
+/*
+ * Resolves addr: "unix:<path>" or "<host>:<port>", an empty host standing
+ * for all addresses when listening
+ * Returns 0 on success
+ */
+int mali_fleet_resolve(const string& addr, bool listening, vector<mali_fleet_address>& out)
+{
+    struct addrinfo hints, *res, *ai;
+    mali_fleet_address a;
+    size_t sep;
+
+    out.clear();
+    memset(&a, 0, sizeof(a));
+
+    if (addr.compare(0, 5, "unix:") == 0)
+    {
+        struct sockaddr_un *sun = reinterpret_cast<struct sockaddr_un *>(&a.addr);
+        string path = addr.substr(5);
+
+        if (path.empty() || path.length() >= sizeof(sun->sun_path))
+            return 1;
+
+        sun->sun_family = AF_UNIX;
+        memcpy(sun->sun_path, path.c_str(), path.length());
+        a.family = AF_UNIX;
+        a.length = sizeof(*sun);
+        out.push_back(a);
+        return 0;
+    }
+
+    if ((sep = addr.rfind(':')) == string::npos)
+        return 1;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = listening ? AI_PASSIVE : 0;
+
+    if (getaddrinfo(sep > 0 ? addr.substr(0, sep).c_str() : NULL, addr.substr(sep + 1).c_str(), &hints, &res) != 0)
+        return 1;
+
+    for (ai = res; ai != NULL; ai = ai->ai_next)
+    {
+        if (ai->ai_addrlen > sizeof(a.addr))
+            continue;
+        a.family = ai->ai_family;
+        a.protocol = ai->ai_protocol;
+        a.length = ai->ai_addrlen;
+        memcpy(&a.addr, ai->ai_addr, ai->ai_addrlen);
+        out.push_back(a);
+    }
+
+    freeaddrinfo(res);
+
+    return out.empty();
+}
+
+/*
+ * Connects a blocking stream socket to the first of addrs that accepts
+ * within timeout_ms
+ * Returns the socket, -1 on failure
+ */
+int mali_fleet_connect(const vector<mali_fleet_address>& addrs, int timeout_ms)
+{
+    for (const mali_fleet_address& a : addrs)
+    {
+        struct pollfd pfd;
+        int fd, err = 0, n;
+        socklen_t len = sizeof(err);
+
+        if ((fd = socket(a.family, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, a.protocol)) < 0)
+            continue;
+
+        // An unreachable aggregator must not stall the node
+        if (connect(fd, reinterpret_cast<const struct sockaddr *>(&a.addr), a.length) != 0)
+        {
+            if (errno == EINPROGRESS)
+            {
+                pfd = {fd, POLLOUT, 0};
+                while ((n = ::poll(&pfd, 1, timeout_ms)) < 0 && errno == EINTR)
+                    ;
+                if (n <= 0 || getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0)
+                    err = ETIMEDOUT;
+            }
+            else
+                err = errno;
+        }
+
+        if (err == 0 && fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK) == 0)
+            return fd;
+
+        close(fd);
+    }
+
+    return -1;
+}
+
+/*
+ * Opens a stream socket on addr (see mali_fleet_resolve()). A listening
+ * socket is non blocking and bound, otherwise the socket is connected
+ * within MALI_FLEET_CONNECT_TIMEOUT_MS.
+ * Returns the socket, -1 on failure
+ */
+int mali_fleet_socket(const string& addr, bool listening)
+{
+    vector<mali_fleet_address> addrs;
+    struct stat st;
+    int one = 1;
+    int fd;
+
+    if (mali_fleet_resolve(addr, listening, addrs))
+        return -1;
+
+    if (!listening)
+        return mali_fleet_connect(addrs, MALI_FLEET_CONNECT_TIMEOUT_MS);
+
+    for (const mali_fleet_address& a : addrs)
+    {
+        if ((fd = socket(a.family, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, a.protocol)) < 0)
+            continue;
+
+        if (a.family == AF_UNIX)
+        {
+            const char *path = reinterpret_cast<const struct sockaddr_un *>(&a.addr)->sun_path;
+
+            // A socket left by a previous aggregator would fail bind, anything else is not ours
+            if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+                unlink(path);
+        }
+        else
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        if (bind(fd, reinterpret_cast<const struct sockaddr *>(&a.addr), a.length) == 0 && ::listen(fd, SOMAXCONN) == 0)
+            return fd;
+
+        close(fd);
+    }
+
+    return -1;
+}
+
+/*
+ * Constructor, n names the node in the fleet
+ */
+mali_fleet_sender::mali_fleet_sender(const string& a, const string& n) : addr(a), node(n), fd(-1)
+{
+    resolved = 0;
+    next_attempt = 0;
+    data.reset(new mali_snapshot_data());
+    frame.reserve(MALI_FLEET_MAX_FRAME_SIZE);
+}
+
+/*
+ * Destructor
+ */
+mali_fleet_sender::~mali_fleet_sender()
+{
+    if (fd >= 0)
+        close(fd);
+}
+
+/*
+ * Sends current state of gpu, connecting first if needed
+ * Returns 0 on success
+ */
+int mali_fleet_sender::send(mali_gpu& gpu, const mali_sampler *sampler)
+{
+    mali_fleet_frame hdr;
+    size_t parts, procs, off = 0;
+    uint64_t now, deadline;
+
+    if (fd < 0)
+    {
+        now = now_ms();
+        if (now < next_attempt)
+            return 1;
+        next_attempt = now + MALI_FLEET_RETRY_MS;
+
+        if (resolved == 0 || now - resolved >= MALI_FLEET_RESOLVE_MS)
+        {
+            if (mali_fleet_resolve(addr, false, addrs))
+                return 1;
+            resolved = now;
+        }
+
+        if ((fd = mali_fleet_connect(addrs, MALI_FLEET_CONNECT_TIMEOUT_MS)) < 0)
+            return 1;
+    }
+
+    mali_snapshot_fill(data.get(), gpu, sampler);
+    parts = data->partition_count * sizeof(mali_snapshot_partition);
+    procs = data->process_count * sizeof(mali_snapshot_process);
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = MALI_FLEET_MAGIC;
+    hdr.version = MALI_FLEET_VERSION;
+    hdr.length = MALI_FLEET_SAMPLE_HEADER_SIZE + parts + procs;
+    strncpy(hdr.node, node.c_str(), sizeof(hdr.node) - 1);
+
+    frame.resize(sizeof(hdr) + hdr.length);
+    memcpy(&frame[0], &hdr, sizeof(hdr));
+    memcpy(&frame[sizeof(hdr)], data.get(), MALI_FLEET_SAMPLE_HEADER_SIZE);
+    memcpy(&frame[sizeof(hdr) + MALI_FLEET_SAMPLE_HEADER_SIZE], data->partitions, parts);
+    memcpy(&frame[sizeof(hdr) + MALI_FLEET_SAMPLE_HEADER_SIZE + parts], data->processes, procs);
+
+    // A stalled aggregator must not stall the node, the whole frame shares one deadline
+    deadline = now_ms() + MALI_FLEET_SEND_TIMEOUT_MS;
+
+    while (off < frame.size())
+    {
+        ssize_t n = ::send(fd, &frame[off], frame.size() - off, MSG_NOSIGNAL | MSG_DONTWAIT);
+        struct pollfd pfd = {fd, POLLOUT, 0};
+
+        if (n > 0)
+        {
+            off += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && errno == EAGAIN && (now = now_ms()) < deadline)
+        {
+            if (::poll(&pfd, 1, deadline - now) >= 0 || errno == EINTR)
+                continue;
+        }
+
+        close(fd);
+        fd = -1;
+        return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Constructor
+ */
+mali_fleet_aggregator::mali_fleet_aggregator()
+{
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+}
+
+/*
+ * Destructor
+ */
+mali_fleet_aggregator::~mali_fleet_aggregator()
+{
+    for (map<int, connection>::value_type& i : connections)
+        close(i.first);
+    for (int i : listeners)
+        close(i);
+    if (epfd >= 0)
+        close(epfd);
+}
+
+/*
+ * Accepts samples from nodes on addr (see mali_fleet_socket())
+ * Returns 0 on success
+ */
+int mali_fleet_aggregator::listen(const string& addr)
+{
+    struct epoll_event ev;
+    int fd;
+
+    if (epfd < 0 || (fd = mali_fleet_socket(addr, true)) < 0)
+    {
+        cout << "Failed to listen on " << addr << endl;
+        return 1;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+    listeners.push_back(fd);
+
+    return 0;
+}
+
+/*
+ * Accepts all pending connections on listening socket lfd
+ */
+void mali_fleet_aggregator::accept_connections(int lfd)
+{
+    struct epoll_event ev;
+    int fd;
+
+    while ((fd = accept4(lfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+    {
+        connection& c = connections[fd];
+
+        c.buf.resize(sizeof(mali_fleet_frame));
+        c.used = 0;
+
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = fd;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+    }
+}
+
+/*
+ * Closes connection fd, its node is kept as disconnected
+ */
+void mali_fleet_aggregator::drop(int fd)
+{
+    map<int, connection>::iterator it = connections.find(fd);
+
+    if (it != connections.end())
+    {
+        if (!it->second.node.empty())
+            nodes[it->second.node].connected = false;
+        connections.erase(it);
+    }
+
+    epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
+    close(fd);
+}
+
+/*
+ * Updates the node of frame f, holding the sample of len bytes
+ * Returns false if the sample is malformed
+ */
+bool mali_fleet_aggregator::parse_frame(connection& c, const char *f, size_t len)
+{
+    mali_fleet_frame hdr;
+    const char *sample = f + sizeof(hdr);
+    uint32_t part_count, proc_count;
+    struct timespec ts;
+
+    if (len < MALI_FLEET_SAMPLE_HEADER_SIZE)
+        return false;
+
+    // Data from the network may be unaligned, it is only memcpy'ed
+    memcpy(&hdr, f, sizeof(hdr));
+    memcpy(&part_count, sample + offsetof(mali_snapshot_data, partition_count), sizeof(part_count));
+    memcpy(&proc_count, sample + offsetof(mali_snapshot_data, process_count), sizeof(proc_count));
+
+    if (part_count > MALI_SNAPSHOT_MAX_PARTITIONS || proc_count > MALI_SNAPSHOT_MAX_PROCESSES
+        || len != MALI_FLEET_SAMPLE_HEADER_SIZE + part_count * sizeof(mali_snapshot_partition)
+                  + proc_count * sizeof(mali_snapshot_process))
+        return false;
+
+    hdr.node[sizeof(hdr.node) - 1] = '\0';
+    if (c.node != hdr.node)
+    {
+        if (!c.node.empty())
+            nodes[c.node].connected = false;
+        c.node = hdr.node;
+
+        // The name moves to this connection, e.g. a node reconnecting before its previous connection timed out
+        for (map<int, connection>::iterator it = connections.begin(); it != connections.end(); it++)
+        {
+            if (&it->second != &c && it->second.node == c.node)
+            {
+                it->second.node.clear();
+                drop(it->first);
+                break;
+            }
+        }
+    }
+
+    mali_fleet_node& n = nodes[c.node];
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    n.name = c.node;
+    n.received = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    memcpy(&n.system_memory, sample + offsetof(mali_snapshot_data, system_memory), sizeof(n.system_memory));
+    memcpy(&n.memory_usage, sample + offsetof(mali_snapshot_data, memory_usage), sizeof(n.memory_usage));
+    n.partitions.resize(part_count);
+    n.processes.resize(proc_count);
+    sample += MALI_FLEET_SAMPLE_HEADER_SIZE;
+    memcpy(n.partitions.data(), sample, part_count * sizeof(mali_snapshot_partition));
+    sample += part_count * sizeof(mali_snapshot_partition);
+    memcpy(n.processes.data(), sample, proc_count * sizeof(mali_snapshot_process));
+
+    // Strings and indexes come from the network, a bad sample disconnects the node
+    n.connected = false;
+    for (mali_snapshot_partition& i : n.partitions)
+    {
+        i.partition_name[sizeof(i.partition_name) - 1] = '\0';
+        i.status[sizeof(i.status) - 1] = '\0';
+    }
+    for (mali_snapshot_process& i : n.processes)
+    {
+        i.cmd[sizeof(i.cmd) - 1] = '\0';
+        if (i.partition >= part_count)
+            return false;
+    }
+    n.connected = true;
+
+    return true;
+}
+
+/*
+ * Reads what connection fd has to offer and handles complete frames
+ * Returns false if the connection must be dropped
+ */
+bool mali_fleet_aggregator::receive(int fd, connection& c)
+{
+    while (1)
+    {
+        mali_fleet_frame hdr;
+        size_t need = sizeof(hdr);
+        ssize_t n;
+
+        // Handle complete frames first
+        while (c.used >= sizeof(hdr))
+        {
+            memcpy(&hdr, &c.buf[0], sizeof(hdr));
+            if (hdr.magic != MALI_FLEET_MAGIC || hdr.version != MALI_FLEET_VERSION
+                || hdr.length > sizeof(mali_snapshot_data))
+                return false;
+
+            need = sizeof(hdr) + hdr.length;
+            if (c.used < need)
+                break;
+
+            if (!parse_frame(c, &c.buf[0], hdr.length))
+                return false;
+
+            memmove(&c.buf[0], &c.buf[need], c.used - need);
+            c.used -= need;
+            need = sizeof(hdr);
+        }
+
+        if (c.buf.size() < need)
+            c.buf.resize(need);
+
+        n = read(fd, &c.buf[c.used], c.buf.size() - c.used);
+
+        if (n > 0)
+            c.used += n;
+        else if (n < 0 && errno == EINTR)
+            continue;
+        else if (n < 0 && errno == EAGAIN)
+            return true;
+        else
+            return false;
+    }
+}
+
+/*
+ * Runs the event loop until events were handled or timeout_ms elapsed
+ * Returns the number of events handled, -1 on failure
+ */
+int mali_fleet_aggregator::run(int timeout_ms)
+{
+    struct epoll_event events[MALI_FLEET_MAX_EVENTS];
+    int n;
+
+    if ((n = epoll_wait(epfd, events, MALI_FLEET_MAX_EVENTS, timeout_ms)) < 0)
+        return errno == EINTR ? 0 : -1;
+
+    for (int i = 0; i < n; i++)
+    {
+        int fd = events[i].data.fd;
+        map<int, connection>::iterator it;
+
+        if (find(listeners.begin(), listeners.end(), fd) != listeners.end())
+            accept_connections(fd);
+        else if ((it = connections.find(fd)) != connections.end() && !receive(fd, it->second))
+            drop(fd);
+    }
+
+    return n;
+}
+
+/*
+ * Returns the total system memory of connected nodes in kB
+ */
+uint64_t mali_fleet_aggregator::get_system_memory() const
+{
+    uint64_t sum = 0;
+
+    for (const map<string, mali_fleet_node>::value_type& i : nodes)
+    {
+        if (i.second.connected)
+            sum += i.second.system_memory;
+    }
+
+    return sum;
+}
+
+/*
+ * Returns the GPU memory usage of connected nodes in kB
+ */
+uint64_t mali_fleet_aggregator::get_memory_usage() const
+{
+    uint64_t sum = 0;
+
+    for (const map<string, mali_fleet_node>::value_type& i : nodes)
+    {
+        if (i.second.connected)
+            sum += i.second.memory_usage;
+    }
+
+    return sum;
+}
+
+/*
+ * Returns the memory headroom of connected nodes in kB
+ */
+uint64_t mali_fleet_aggregator::get_headroom() const
+{
+    uint64_t sum = 0;
+
+    for (const map<string, mali_fleet_node>::value_type& i : nodes)
+    {
+        if (i.second.connected)
+            sum += i.second.headroom();
+    }
+
+    return sum;
+}
+
+/*
+ * Returns partitions of connected nodes
+ */
+vector<mali_fleet_partition> mali_fleet_aggregator::get_partitions() const
+{
+    vector<mali_fleet_partition> out;
+
+    for (const map<string, mali_fleet_node>::value_type& i : nodes)
+    {
+        if (!i.second.connected)
+            continue;
+        for (const mali_snapshot_partition& p : i.second.partitions)
+            out.push_back(mali_fleet_partition{ &i.second, &p });
+    }
+
+    return out;
+}
+
+/*
+ * Returns partitions of connected nodes not in active status
+ */
+vector<mali_fleet_partition> mali_fleet_aggregator::get_non_active_partitions() const
+{
+    vector<mali_fleet_partition> out = get_partitions();
+
+    out.erase(remove_if(out.begin(), out.end(),
+                        [](const mali_fleet_partition& p) { return strcmp(p.partition->status, "active") == 0; }),
+              out.end());
+
+    return out;
+}
+
+/*
+ * Returns the n processes using the most GPU memory across connected nodes
+ */
+vector<mali_fleet_process> mali_fleet_aggregator::get_top_processes(size_t n) const
+{
+    vector<mali_fleet_process> out;
+
+    for (const map<string, mali_fleet_node>::value_type& i : nodes)
+    {
+        if (!i.second.connected)
+            continue;
+        for (const mali_snapshot_process& p : i.second.processes)
+            out.push_back(mali_fleet_process{ &i.second, &i.second.partitions[p.partition], &p });
+    }
+
+    n = min(n, out.size());
+    partial_sort(out.begin(), out.begin() + n, out.end(),
+                 [](const mali_fleet_process& a, const mali_fleet_process& b)
+                 { return a.process->memory_usage > b.process->memory_usage; });
+    out.resize(n);
+
+    return out;
+}
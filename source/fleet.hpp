@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _FLEET_H_
+#define _FLEET_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+
+#include "gpu.hpp"
+#include "sampler.hpp"
+#include "snapshot.hpp"
+
+#define MALI_FLEET_MAGIC 0x4d474d46 // "FMGM"
+#define MALI_FLEET_VERSION 1
+#define MALI_FLEET_NODE_LEN 64
+#define MALI_FLEET_MAX_EVENTS 64
+#define MALI_FLEET_TOP_PROCESSES 10
+#define MALI_FLEET_CONNECT_TIMEOUT_MS 1000
+#define MALI_FLEET_SEND_TIMEOUT_MS 1000 // per frame
+#define MALI_FLEET_RETRY_MS 1000       // between connection attempts
+#define MALI_FLEET_RESOLVE_MS 30000    // between host name resolutions
+
+using namespace std;
+
+/*
+ * Frame of the sample stream, followed by the used part of a
+ * mali_snapshot_data: its fields up to partitions, then partition_count
+ * partitions and process_count processes. Fields are fixed width in host
+ * byte order, nodes and aggregator are expected to share it.
+ */
+struct mali_fleet_frame
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t length;   // bytes following the frame header
+    char node[MALI_FLEET_NODE_LEN];
+};
+
+#define MALI_FLEET_SAMPLE_HEADER_SIZE offsetof(mali_snapshot_data, partitions)
+#define MALI_FLEET_MAX_FRAME_SIZE (sizeof(mali_fleet_frame) + sizeof(mali_snapshot_data))
+
+/*
+ * Resolved socket address
+ */
+struct mali_fleet_address
+{
+    int family;
+    int protocol;
+    socklen_t length;
+    struct sockaddr_storage addr;
+};
+
+int mali_fleet_resolve(const string& addr, bool listening, vector<mali_fleet_address>& out);
+int mali_fleet_connect(const vector<mali_fleet_address>& addrs, int timeout_ms);
+int mali_fleet_socket(const string& addr, bool listening);
+
+/*
+ * Streams samples of a node to an aggregator at addr: "unix:<path>" or
+ * "<host>:<port>". Connects lazily and reconnects after a failure, at most
+ * every MALI_FLEET_RETRY_MS, with addr resolved at most every
+ * MALI_FLEET_RESOLVE_MS. A frame not sent within MALI_FLEET_SEND_TIMEOUT_MS
+ * closes the connection.
+ */
+class mali_fleet_sender
+{
+    private:
+        string addr;
+        string node;
+        int fd;
+        vector<mali_fleet_address> addrs;
+        uint64_t resolved;      // CLOCK_MONOTONIC in ms, 0 if never
+        uint64_t next_attempt;  // CLOCK_MONOTONIC in ms
+        unique_ptr<mali_snapshot_data> data;
+        vector<char> frame;
+
+    public:
+        bool is_connected() const { return fd >= 0; };
+        int send(mali_gpu& gpu, const mali_sampler *sampler = NULL);
+        // Constructor / Destructor
+        mali_fleet_sender(const string& a, const string& n);
+        mali_fleet_sender(const mali_fleet_sender&) = delete;
+        ~mali_fleet_sender();
+};
+
+/*
+ * Last sample received from a node
+ */
+struct mali_fleet_node
+{
+    string name;
+    bool connected;
+    uint64_t received;      // CLOCK_MONOTONIC in ns
+    uint64_t system_memory; // in kB
+    uint64_t memory_usage;  // in kB
+    vector<mali_snapshot_partition> partitions;
+    vector<mali_snapshot_process> processes;
+
+    // GPU memory is taken from system memory, partitions share their node headroom
+    uint64_t headroom() const { return system_memory > memory_usage ? system_memory - memory_usage : 0; };
+};
+
+struct mali_fleet_partition
+{
+    const mali_fleet_node *node;
+    const mali_snapshot_partition *partition;
+};
+
+struct mali_fleet_process
+{
+    const mali_fleet_node *node;
+    const mali_snapshot_partition *partition;
+    const mali_snapshot_process *process;
+};
+
+/*
+ * Merges sample streams of many nodes into a fleet-wide view, from a
+ * single threaded epoll event loop. Query results point into the view and
+ * are valid until the next run(). A node name is held by one connection,
+ * the latest one to send it, previous ones are dropped.
+ */
+class mali_fleet_aggregator
+{
+    private:
+        struct connection
+        {
+            vector<char> buf;
+            size_t used;
+            string node; // last node seen on the connection
+        };
+
+        int epfd;
+        vector<int> listeners;
+        map<int, connection> connections;
+        map<string, mali_fleet_node> nodes;
+
+        void accept_connections(int lfd);
+        bool receive(int fd, connection& c);
+        bool parse_frame(connection& c, const char *f, size_t len);
+        void drop(int fd);
+
+    public:
+        // Getter
+        const map<string, mali_fleet_node>& get_nodes() const { return nodes; };
+        size_t get_connection_count() const { return connections.size(); };
+        // Queries
+        uint64_t get_system_memory() const;
+        uint64_t get_memory_usage() const;
+        uint64_t get_headroom() const;
+        vector<mali_fleet_partition> get_partitions() const;
+        vector<mali_fleet_partition> get_non_active_partitions() const;
+        vector<mali_fleet_process> get_top_processes(size_t n) const;
+        //
+        int listen(const string& addr);
+        int run(int timeout_ms);
+        // Constructor / Destructor
+        mali_fleet_aggregator();
+        mali_fleet_aggregator(const mali_fleet_aggregator&) = delete;
+        ~mali_fleet_aggregator();
+};
+
+#endif // _FLEET_H_
@@ -22,6 +22,11 @@
  * SOFTWARE.
  */
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
 #include "gpu.hpp"
 #include "utils.hpp"
 
@@ -34,6 +39,7 @@ void mali_gpu::set_name()
     string gpuinfo_f = find_file(MALI_GPU_PATH, "gpuinfo");
 
     name = get_file_content(gpuinfo_f);
+    loaded |= MALI_FIELD_NAME;
 }
 
 /*
@@ -42,6 +48,7 @@ void mali_gpu::set_name()
 void mali_gpu::set_ddk_version()
 {
     ddk_version = get_file_content(MALI_DDK_VERSION);
+    loaded |= MALI_FIELD_DDK_VERSION;
 }
 
 /*
@@ -51,8 +58,10 @@ void mali_gpu::set_memory_usage()
 {
     memory_usage = 0;
 
-    for(mali_partition& i : partitions)
+    for(mali_partition& i : get_partitions())
         memory_usage += i.get_memory_usage();
+
+    loaded |= MALI_FIELD_MEMORY;
 }
 
 /*
@@ -64,6 +73,38 @@ void mali_gpu::set_system_memory()
     long page_size = sysconf(_SC_PAGE_SIZE);
 
     system_memory = pages * page_size / 1024;
+    loaded |= MALI_FIELD_SYSTEM_MEMORY;
+}
+
+/*
+ * Returns CLOCK_MONOTONIC in ms
+ */
+static uint64_t now_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * Returns true if part names a sampled partition: only mali* devices of
+ * the misc class, matching the filter
+ */
+static bool is_partition(const char *part, const mali_filter& filter)
+{
+    return strstr(part, "mali") != NULL && filter.match_partition(part);
+}
+
+/*
+ * Adds partition part, reading its declared fields
+ */
+void mali_gpu::add_partition(const char *part)
+{
+    partitions.emplace_back(part, fields, filter.filters_processes() ? &filter : NULL);
+    if (load_observer)
+        partitions.back().set_observer(&load_observer);
 }
 
 /*
@@ -71,46 +112,349 @@ void mali_gpu::set_system_memory()
  */
 void mali_gpu::set_partitions()
 {
-    DIR *dir;
-    struct dirent *ent;
+    mali_dir dir(MALI_CLASS_PATH);
+    const char *ent;
+
+    partitions_loaded = true;
+    last_rescan = now_ms();
+
+    // only count mali* folders in directory, filtered out ones are never read
+    while ((ent = dir.next()) != NULL)
+    {
+        if (is_partition(ent, filter))
+            add_partition(ent);
+    }
+
+    sort(partitions.begin(), partitions.end(),
+         [](const mali_partition& a, const mali_partition& b) { return a.get_partition_id() < b.get_partition_id(); });
+}
+
+/*
+ * Returns true if the partitions listed in system configuration differ
+ * from the current ones, without allocating
+ */
+bool mali_gpu::topology_changed()
+{
+    mali_dir dir(MALI_CLASS_PATH);
+    const char *ent;
+    size_t count = 0;
+
+    while ((ent = dir.next()) != NULL)
+    {
+        if (!is_partition(ent, filter))
+            continue;
+
+        if (find_if(partitions.begin(), partitions.end(),
+                    [ent](const mali_partition& p) { return p.get_partition_name() == ent; }) == partitions.end())
+            return true;
+        count++;
+    }
+
+    return count != partitions.size();
+}
+
+/*
+ * Adds partitions that appeared in system configuration and retires those
+ * that disappeared, leaving others untouched. Changes are reported in the
+ * change set of the current update.
+ */
+void mali_gpu::rescan()
+{
+    mali_dir dir(MALI_CLASS_PATH);
+    const char *ent;
+    vector<string> names;
+    size_t count = partitions.size();
+
+    last_rescan = now_ms();
+
+    if (!partitions_loaded || !topology_changed())
+        return;
+
+    while ((ent = dir.next()) != NULL)
+    {
+        if (is_partition(ent, filter))
+            names.push_back(ent);
+    }
+
+    for (vector<mali_partition>::iterator it = partitions.begin(); it != partitions.end();)
+    {
+        if (find(names.begin(), names.end(), it->get_partition_name()) == names.end())
+        {
+            changes.add(mali_change(MALI_CHANGE_PARTITION_REMOVED, it->get_partition_id()));
+            it = partitions.erase(it);
+            count--;
+        }
+        else
+            it++;
+    }
+
+    for (const string& i : names)
+    {
+        if (find_if(partitions.begin(), partitions.begin() + count,
+                    [&i](const mali_partition& p) { return p.get_partition_name() == i; }) == partitions.begin() + count)
+        {
+            add_partition(i.c_str());
+            changes.add(mali_change(MALI_CHANGE_PARTITION_ADDED, partitions.back().get_partition_id()));
+        }
+    }
+
+    sort(partitions.begin(), partitions.end(),
+         [](const mali_partition& a, const mali_partition& b) { return a.get_partition_id() < b.get_partition_id(); });
+}
+
+/*
+ * Tracks partitions being added or removed from kernel uevents, on socket
+ * sock if set (e.g. for testing) or on a NETLINK_KOBJECT_UEVENT socket.
+ * Periodic rescans remain as a fallback.
+ * Returns 0 on success
+ */
+int mali_gpu::watch_topology(int sock)
+{
+    uevents.reset(sock >= 0 ? new mali_uevent_listener(sock) : new mali_uevent_listener());
+
+    if (!uevents->is_open())
+    {
+        uevents.reset();
+        return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Marks the partitions whose contexts must be listed again although their
+ * ctx directory did not change: those a listed or rejected process exec'd
+ * from, with its command and cgroup read again, and all of them if events
+ * were lost
+ */
+void mali_gpu::track_processes()
+{
+    if (proc_events->poll())
+    {
+        for (mali_partition& i : partitions)
+            i.refresh_processes();
+        index_valid = false;
+    }
 
-    // Set number of partitions
-    if ((dir = opendir(MALI_CLASS_PATH)) != NULL)
+    for (pid_t pid : proc_events->get_execs())
     {
-        // loop in all folders in directory
-        while ((ent = readdir(dir)) != NULL)
+        // Without command line globs, filtered out processes are never listed
+        if (!filter.filters_cmds() && !filter.match_pid(pid))
+            continue;
+
+        for (mali_partition& i : partitions)
         {
-            string d_name = ent->d_name;
-            // only count mali* folders in directory
-            if (d_name.find("mali") != string::npos)
+            // A rejected process may now match a command line glob
+            if (i.find_process(pid) != NULL || i.is_rejected(pid))
             {
-                partitions.push_back(mali_partition(d_name));
+                i.refresh_process(pid);
+                index_valid = false;
             }
         }
+    }
+}
+
+/*
+ * Tracks process execs from kernel proc connector events, on socket sock
+ * if set (e.g. for testing) or on a NETLINK_CONNECTOR socket: contexts of
+ * a listed process that exec'd are listed again, along with its new
+ * command. Events only trigger listings, processes are still found from
+ * the ctx directories.
+ * Returns 0 on success, commands are only read again on rescans otherwise
+ */
+int mali_gpu::watch_processes(int sock)
+{
+    proc_events.reset(sock >= 0 ? new mali_proc_listener(sock) : new mali_proc_listener());
+
+    if (!proc_events->is_open())
+        proc_events.reset();
+
+    return proc_events ? 0 : 1;
+}
+
+/*
+ * Sets the observer notified of partition fields as they are read
+ * during updates
+ */
+void mali_gpu::set_load_observer(mali_load_observer cb)
+{
+    load_observer = cb;
+
+    for (mali_partition& i : partitions)
+        i.set_observer(load_observer ? &load_observer : NULL);
+}
+
+/*
+ * Returns the partition with the given id, NULL if there is none
+ */
+mali_partition *mali_gpu::find_partition(uint32_t id)
+{
+    for (mali_partition& i : get_partitions())
+    {
+        if (i.get_partition_id() == id)
+            return &i;
+    }
+
+    return NULL;
+}
+
+/*
+ * Returns GPU usage of cgroup prefix and of all cgroups below it, across
+ * all partitions
+ */
+mali_cgroup_usage mali_gpu::get_cgroup_usage(const string& prefix)
+{
+    mali_cgroup_usage sum = {0, 0};
 
-        closedir(dir);
+    for (mali_partition& i : get_partitions())
+    {
+        mali_cgroup_usage u = i.get_cgroup_usage(prefix);
+
+        sum.memory_usage += u.memory_usage;
+        sum.process_count += u.process_count;
+    }
+
+    return sum;
+}
+
+/*
+ * Builds the cross-partition process index from the current snapshot
+ */
+void mali_gpu::set_process_index()
+{
+    index.clear();
+
+    for (mali_partition& i : get_partitions())
+    {
+        for (mali_process& p : i.get_processes(MALI_FIELD_PROCESSES | MALI_FIELD_PROCESS_MEMORY | MALI_FIELD_PROCESS_CMD))
+            index.add(p.get_pid(), i.get_partition_id(), p.get_memory_usage(), p.get_cmd());
+    }
+
+    index_valid = true;
+}
+
+/*
+ * Applies the changes of the current update to the process index, memory
+ * usage is as of the last reported change
+ */
+void mali_gpu::update_process_index()
+{
+    for (const mali_change& c : changes)
+    {
+        mali_partition *part = find_partition(c.partition_id);
+        mali_process *proc;
+
+        switch (c.kind)
+        {
+            case MALI_CHANGE_PARTITION_REMOVED:
+                index.remove_partition(c.partition_id);
+                break;
+            case MALI_CHANGE_PARTITION_ADDED:
+                for (mali_process& p : part->get_processes(MALI_FIELD_PROCESSES | MALI_FIELD_PROCESS_MEMORY | MALI_FIELD_PROCESS_CMD))
+                    index.add(p.get_pid(), c.partition_id, p.get_memory_usage(), p.get_cmd());
+                break;
+            case MALI_CHANGE_PROCESS_ARRIVED:
+                // Only commands of new processes are read, others are carried over
+                part->get_processes(MALI_FIELD_PROCESS_CMD);
+                proc = part->find_process(c.pid);
+                index.add(c.pid, c.partition_id, c.new_memory, proc != NULL ? proc->get_cmd() : "");
+                break;
+            case MALI_CHANGE_PROCESS_EXITED:
+                index.remove(c.pid, c.partition_id);
+                break;
+            case MALI_CHANGE_PROCESS_MEMORY:
+                index.set_memory_usage(c.pid, c.partition_id, c.new_memory);
+                break;
+            default:
+                break;
+        }
     }
 }
 
 /*
  * Constructor
+ * Only fields f are read, other fields are read on first access
  */
-mali_gpu::mali_gpu(bool emit_yaml)
+mali_gpu::mali_gpu(uint32_t f) : mali_gpu(mali_filter(f))
 {
-    set_name();
-    set_ddk_version();
-    set_system_memory();
-    set_partitions();
-    set_memory_usage();
 }
 
 /*
- * Update status
+ * Constructor
+ * Only partitions and processes matching flt are sampled, and only its
+ * fields are read, other fields are read on first access
  */
-void mali_gpu::update()
+mali_gpu::mali_gpu(const mali_filter& flt) : filter(flt)
 {
+    fields = filter.get_fields();
+    loaded = 0;
+    rescan_interval = MALI_RESCAN_INTERVAL_MS;
+    last_rescan = 0;
+    partitions_loaded = false;
+    index_valid = false;
+    epoch = 0;
+    memory_epsilon = 0;
+
+    if (fields & MALI_FIELD_NAME)
+        set_name();
+    if (fields & MALI_FIELD_DDK_VERSION)
+        set_ddk_version();
+    if (fields & MALI_FIELD_SYSTEM_MEMORY)
+        set_system_memory();
+    if (fields & (MALI_FIELD_PARTITION_ALL | MALI_FIELD_PROCESS_ALL))
+        set_partitions();
+    if (fields & MALI_FIELD_MEMORY)
+        set_memory_usage();
+}
+
+/*
+ * Update status, starting a new sampling epoch
+ * Returns what changed in declared fields since the previous update,
+ * subscribers are notified of each change before returning
+ */
+const mali_change_set& mali_gpu::update()
+{
+    bool rescan_due;
+
+    changes.clear();
+    epoch++;
+    loaded &= ~MALI_FIELD_MEMORY;
+
+    rescan_due = rescan_interval && now_ms() - last_rescan >= rescan_interval;
+
+    // Uevents must be drained even if a rescan is due anyway
+    if ((uevents && uevents->poll()) | rescan_due)
+        rescan();
+
+    if (proc_events)
+        track_processes();
+
+    // Processes may exec without releasing their contexts, commands are
+    // read again on each rescan
+    if (rescan_due)
+    {
+        for (mali_partition& i : partitions)
+            i.refresh_processes();
+        index_valid = false;
+    }
+
     for(mali_partition& i : partitions)
-        i.update();
+        i.update(changes, memory_epsilon);
+
+    if (fields & MALI_FIELD_MEMORY)
+        set_memory_usage();
+
+    // The process index follows reported changes, or is rebuilt on access
+    if (index_valid && (fields & MALI_FIELD_PROCESSES) && (fields & MALI_FIELD_PROCESS_MEMORY))
+        update_process_index();
+    else
+        index_valid = false;
+
+    for(const mali_change& c : changes)
+    {
+        for(mali_change_callback& cb : subscribers[c.kind])
+            cb(c);
+    }
 
-    set_memory_usage();
+    return changes;
 }
\ No newline at end of file
@@ -25,47 +25,105 @@
 #ifndef _GPU_H_
 #define _GPU_H_
 
+#include <memory>
 #include <string>
 #include <dirent.h>
 #include <unistd.h>
 #include <vector>
 
+#include "changes.hpp"
+#include "fields.hpp"
+#include "filter.hpp"
 #include "partition.hpp"
+#include "procconn.hpp"
+#include "procindex.hpp"
+#include "uevent.hpp"
 #include "utils.hpp"
 
+#ifndef MALI_DDK_VERSION
 #define MALI_DDK_VERSION "/sys/module/mali_kbase/version"
+#endif
+#ifndef MALI_GPU_PATH
 #define MALI_GPU_PATH "/sys/devices/platform"
+#endif
+#ifndef MALI_CLASS_PATH
 #define MALI_CLASS_PATH "/sys/class/misc"
+#endif
+#define MALI_RESCAN_INTERVAL_MS 10000
 
 using namespace std;
 
 class mali_gpu
 {
     private:
+        uint32_t fields; // declared fields, read on each update
+        mali_filter filter;
+        uint32_t loaded; // GPU fields read, name and versions are memoized for good
+        bool partitions_loaded;
+        uint64_t epoch;
         string name;
         string ddk_version;
         uint64_t system_memory; // in kB
         uint64_t memory_usage;  // in kB
         vector<mali_partition> partitions;
+        mali_change_set changes;
+        uint64_t memory_epsilon; // in kB
+        vector<mali_change_callback> subscribers[MALI_CHANGE_KIND_COUNT];
+        mali_load_observer load_observer;
+        // Topology tracking
+        unique_ptr<mali_uevent_listener> uevents;
+        uint64_t rescan_interval; // in ms, 0 to disable
+        uint64_t last_rescan;     // CLOCK_MONOTONIC in ms
+        // Process lifecycle tracking
+        unique_ptr<mali_proc_listener> proc_events;
+        // Cross-partition process index, valid for the current epoch
+        mali_process_index index;
+        bool index_valid;
+
+        void add_partition(const char *part);
+        bool topology_changed();
+        void track_processes();
+        void update_process_index();
 
     public:
         // Getter
-        string get_name() { return name; };
-        string get_ddk_version() { return ddk_version; };
-        uint64_t get_system_memory() { return system_memory; };
-        uint64_t get_memory_usage() { return memory_usage; };
-        vector<mali_partition> get_partitions() { return partitions; };
+        const string& get_name() { if (!(loaded & MALI_FIELD_NAME)) set_name(); return name; };
+        const string& get_ddk_version() { if (!(loaded & MALI_FIELD_DDK_VERSION)) set_ddk_version(); return ddk_version; };
+        uint64_t get_system_memory() { if (!(loaded & MALI_FIELD_SYSTEM_MEMORY)) set_system_memory(); return system_memory; };
+        uint64_t get_memory_usage() { if (!(loaded & MALI_FIELD_MEMORY)) set_memory_usage(); return memory_usage; };
+        vector<mali_partition>& get_partitions() { if (!partitions_loaded) set_partitions(); return partitions; };
+        uint32_t get_fields() const { return fields; };
+        const mali_filter& get_filter() const { return filter; };
+        uint64_t get_epoch() const { return epoch; };
+        mali_partition *find_partition(uint32_t id);
+        mali_cgroup_usage get_cgroup_usage(const string& prefix);
+        const mali_change_set& get_changes() { return changes; };
+        int get_process_fd() const { return proc_events ? proc_events->get_fd() : -1; };
+        const mali_process_index& get_process_index() { if (!index_valid) set_process_index(); return index; };
         // Setter - from system config
         void set_name();
         void set_ddk_version();
         void set_system_memory();
         void set_partitions();
         void set_memory_usage();
+        void set_process_index();
+        // Setter - change reporting
+        void set_memory_epsilon(uint64_t eps) { memory_epsilon = eps; };
+        void subscribe(mali_change_kind kind, mali_change_callback cb) { subscribers[kind].push_back(cb); };
+        void set_load_observer(mali_load_observer cb);
+        // Setter - topology tracking
+        int watch_topology(int sock = -1);
+        void set_rescan_interval(uint64_t ms) { rescan_interval = ms; };
+        void rescan();
+        // Setter - process lifecycle tracking
+        int watch_processes(int sock = -1);
         // Constructor/Destructor
-        mali_gpu( bool emit_yaml=false );
+        mali_gpu( uint32_t f=MALI_FIELD_ALL );
+        mali_gpu( const mali_filter& flt );
+        mali_gpu( const mali_gpu& ) = delete; // partitions point to filter
         ~mali_gpu() { partitions.clear(); };
         //
-        void update();
+        const mali_change_set& update();
 };
 
 #endif // _GPU_H_
\ No newline at end of file
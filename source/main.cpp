@@ -23,14 +23,19 @@
  */
 
 #include <iostream>
+#include <iomanip>
 #include <cstring>
-#include <bitset>
-#include <sstream>
+#include <ctime>
 
 #include "utils.hpp"
 #include "process.hpp"
 #include "partition.hpp"
 #include "gpu.hpp"
+#include "snapshot.hpp"
+#include "reconciler.hpp"
+#include "sampler.hpp"
+#include "trace.hpp"
+#include "fleet.hpp"
 
 using namespace std;
 
@@ -60,32 +65,6 @@ string load_bar(uint64_t val, uint64_t ref)
     return out;    
 }
 
-/*
- * Convert string representing hex value to list of bit id
- */
-string hex_to_id(string val)
-{
-    string bin, ret="";
-    uint64_t n, i=val.length();
-
-    istringstream(val) >> std::hex >> n;
-    bin = std::bitset<4>{n}.to_string();
-
-    // Reads indexes in reverse
-    for(char& c : bin) 
-    {
-        if(c == '1')
-        {
-            ret += to_string(i);
-            ret += " ";
-        }
-
-        i--;
-    }
-
-    return ret;
-}
-
 /*
  * Printable gpu class
  */
@@ -93,7 +72,10 @@ class printable_mali_gpu : public mali_gpu
 {
     public:
         bool display_yaml;
-        printable_mali_gpu( bool emit_yaml=false ) { display_yaml = emit_yaml; };
+        const mali_sampler *sampler;
+        uint64_t sample_cost;   // thread CPU time of a one-shot sample, in ns
+        size_t top; // only print the top processes if set
+        printable_mali_gpu( const mali_filter& flt, bool emit_yaml=false ) : mali_gpu(flt) { display_yaml = emit_yaml; sampler = NULL; sample_cost = 0; top = 0; };
         ~printable_mali_gpu() {};
 };
 
@@ -103,7 +85,10 @@ class printable_mali_gpu : public mali_gpu
 ostream& operator<<(ostream& os, mali_process& obj) 
 {
     os << "      PID " << obj.get_pid() << ":" << endl;
-    os << "        Command: " << obj.get_cmd() << endl;
+    if(obj.get_cmd()[0] != '\0')
+        os << "        Command: " << obj.get_cmd() << endl;
+    if(obj.get_cgroup()[0] != '\0')
+        os << "        Cgroup: " << obj.get_cgroup() << endl;
     if(obj.get_memory_usage() >= 0)
         os << "        Memory usage (kB): " << obj.get_memory_usage() << endl;
 
@@ -115,15 +100,33 @@ ostream& operator<<(ostream& os, mali_process& obj)
  */
 ostream& operator<<(ostream& os, mali_partition& obj) 
 {
-    vector<mali_process> procs = obj.get_processes();
+    uint32_t fields = obj.get_fields();
 
     os << "  Partition " << obj.get_partition_name() << ":" << endl;
-    os << "    Status: " << obj.get_status() << endl;
-    if(obj.get_slices() != "N/A")
-        os << "    Allocated slice ID(s): " << hex_to_id(obj.get_slices()) << endl;
-    if(obj.get_assigned_aw() != "N/A")
-        os << "    Assigned access window ID: " << hex_to_id(obj.get_assigned_aw()) << endl;
-    os << "    Memory usage (kB): " << obj.get_memory_usage() << endl;
+    if(fields & MALI_FIELD_STATUS)
+        os << "    Status: " << mali_status_name(obj.get_status()) << endl;
+    if((fields & MALI_FIELD_SLICES) && obj.get_slices().is_valid())
+        os << "    Allocated slice ID(s): " << obj.get_slices().to_ids() << endl;
+    if((fields & MALI_FIELD_ASSIGNED_AW) && obj.get_assigned_aw().is_valid())
+        os << "    Assigned access window ID: " << obj.get_assigned_aw().to_ids() << endl;
+    if(fields & MALI_FIELD_MEMORY)
+        os << "    Memory usage (kB): " << obj.get_memory_usage() << endl;
+    if(fields & MALI_FIELD_PM_COUNTERS)
+    {
+        mali_duty_cycle dc = obj.get_duty_cycle();
+
+        if(dc.valid)
+            os << "    Duty cycle (%): " << static_cast<int>(dc.duty_cycle * 100) << endl;
+        if(obj.get_frequency() > 0)
+            os << "    Frequency (Hz): " << obj.get_frequency() << endl;
+        if(obj.get_load() >= 0)
+            os << "    Load (%): " << obj.get_load() << endl;
+    }
+    if(!(fields & MALI_FIELD_PROCESS_ALL))
+        return os;
+
+    vector<mali_process>& procs = obj.get_processes(fields);
+
     os << "    Running processes: ";
 
     if(procs.empty())
@@ -142,7 +145,8 @@ ostream& operator<<(ostream& os, mali_partition& obj)
  */
 ostream& operator<<(ostream& os, printable_mali_gpu& obj) 
 {
-    vector<mali_partition> part = obj.get_partitions();
+    vector<mali_partition>& part = obj.get_partitions();
+    uint32_t fields = obj.get_fields();
 
     if(part.empty())
         os << "Could not found any Mali GPU" << endl;
@@ -153,45 +157,141 @@ ostream& operator<<(ostream& os, printable_mali_gpu& obj)
             os << "---" << endl;
         }
         os << "GPU configuration: " << endl;
-        os << "  Name: " << obj.get_name() << endl;
-        if(obj.get_ddk_version() != "N/A")
+        if(fields & MALI_FIELD_NAME)
+            os << "  Name: " << obj.get_name() << endl;
+        if((fields & MALI_FIELD_DDK_VERSION) && obj.get_ddk_version() != "N/A")
             os << "  DDK version: " << obj.get_ddk_version() << endl;
         os << "  Available partitions: " << obj.get_partitions().size() << endl;
-        os << "  GPU memory usage (kB): ";
-        if(obj.display_yaml)
-            os << obj.get_memory_usage() << endl;
-        else
-            os << "         " << load_bar(obj.get_memory_usage(), obj.get_system_memory()) << " system memory" << endl;
-        if(!obj.display_yaml)
+        if(fields & MALI_FIELD_MEMORY)
         {
-            if(obj.get_partitions().size() > 1)
+            os << "  GPU memory usage (kB): ";
+            if(obj.display_yaml || !(fields & MALI_FIELD_SYSTEM_MEMORY))
+                os << obj.get_memory_usage() << endl;
+            else
+                os << "         " << load_bar(obj.get_memory_usage(), obj.get_system_memory()) << " system memory" << endl;
+            if(!obj.display_yaml)
             {
-                for(mali_partition& i : part)
+                if(obj.get_partitions().size() > 1)
                 {
-                    os << "    Partition " << i.get_partition_name() << " memory usage: ";
-                    os << load_bar(i.get_memory_usage(), obj.get_memory_usage()) << " GPU memory usage" << endl;
+                    for(mali_partition& i : part)
+                    {
+                        os << "    Partition " << i.get_partition_name() << " memory usage: ";
+                        os << load_bar(i.get_memory_usage(), obj.get_memory_usage()) << " GPU memory usage" << endl;
+                    }
                 }
             }
         }
         
-        os << "  Total system memory (kB): " << obj.get_system_memory() << endl;
+        if(fields & MALI_FIELD_SYSTEM_MEMORY)
+            os << "  Total system memory (kB): " << obj.get_system_memory() << endl;
+        if(obj.sampler)
+        {
+            os << fixed << setprecision(2);
+            os << "  Sampling rate (Hz): " << obj.sampler->get_rate() << endl;
+            os << "  Sampling overhead (% of one core): " << obj.sampler->get_overhead() * 100 << endl;
+            os << defaultfloat;
+        }
+        else if(obj.sample_cost)
+        {
+            // A single sample has no rate, its overhead is what it cost
+            os << fixed << setprecision(2);
+            os << "  Sampling rate (Hz): N/A" << endl;
+            os << "  Sampling cost (ms of CPU time): " << obj.sample_cost / 1e6 << endl;
+            os << defaultfloat;
+        }
 
         if(!obj.display_yaml)
             os << endl;
 
-        for(mali_partition& i : part)
-            cout << i;
+        if(obj.top > 0)
+        {
+            vector<const mali_index_entry *> top = obj.get_process_index().get_top(obj.top);
+
+            os << "Top processes: ";
+            if(top.empty())
+                os << "None" << endl;
+            else
+            {
+                os << endl;
+                for(const mali_index_entry *i : top)
+                {
+                    os << "  " << obj.find_partition(i->partition_id)->get_partition_name() << " PID " << i->pid;
+                    os << " (" << i->cmd << "): " << i->memory_usage << " kB" << endl;
+                }
+            }
+        }
+        else
+        {
+            for(mali_partition& i : part)
+                cout << i;
+        }
     }
 
     return os;
 }
 
+/*
+ * Print fleet view
+ */
+ostream& operator<<(ostream& os, mali_fleet_aggregator& obj)
+{
+    size_t connected = 0;
+
+    for(const pair<const string, mali_fleet_node>& i : obj.get_nodes())
+        connected += i.second.connected;
+
+    os << "Fleet: " << endl;
+    os << "  Nodes: " << obj.get_nodes().size() << " (" << connected << " connected)" << endl;
+    os << "  GPU memory usage (kB): " << obj.get_memory_usage() << endl;
+    os << "  Total system memory (kB): " << obj.get_system_memory() << endl;
+    os << "  Memory headroom (kB): " << obj.get_headroom() << endl;
+    os << "  Partitions: " << endl;
+    for(mali_fleet_partition& i : obj.get_partitions())
+    {
+        os << "    " << i.node->name << "/" << i.partition->partition_name << ": " << i.partition->status;
+        os << ", memory usage (kB) " << i.partition->memory_usage << ", headroom (kB) " << i.node->headroom() << endl;
+    }
+    os << "  Non-active partitions: ";
+    if(obj.get_non_active_partitions().empty())
+        os << "None" << endl;
+    else
+    {
+        os << endl;
+        for(mali_fleet_partition& i : obj.get_non_active_partitions())
+            os << "    " << i.node->name << "/" << i.partition->partition_name << ": " << i.partition->status << endl;
+    }
+    os << "  Top processes: ";
+    if(obj.get_top_processes(MALI_FLEET_TOP_PROCESSES).empty())
+        os << "None" << endl;
+    else
+    {
+        os << endl;
+        for(mali_fleet_process& i : obj.get_top_processes(MALI_FLEET_TOP_PROCESSES))
+        {
+            os << "    " << i.node->name << "/" << i.partition->partition_name << " PID " << i.process->pid;
+            os << " (" << i.process->cmd << "): " << i.process->memory_usage << " kB" << endl;
+        }
+    }
+
+    return os;
+}
 
 int main(int argc, char *argv[])
 {
     bool emit_yaml = false, auto_update = false;
-    string slices = "", p_slices = "", aw = "", p_aw = "";
+    string p_slices = "", p_aw = "", shm_name = "", layout = "", trace_file = "";
+    bool keep_reconciling = false;
+    double budget = MALI_SAMPLER_BUDGET;
+    size_t top = 0;
+    mali_filter filter;
+    vector<string> fleet_addrs;
+    string send_addr = "", node_name = "";
+    mali_fleet_sender *sender = NULL;
+    mali_mask slices, aw;
     printable_mali_gpu *device;
+    mali_snapshot_writer *snapshot = NULL;
+    mali_trace_writer *trace = NULL;
+    struct timespec start, end;
 
     for (int i = 1; i < argc; i++)
     {
@@ -203,13 +303,66 @@ int main(int argc, char *argv[])
         {
             auto_update = true;
         }
+        if ((!strcmp(argv[i], "-T")) || (!strcmp(argv[i], "--top")))
+        {
+            i++;
+            top = strtoul(argv[i], NULL, 10);
+        }
+        if ((!strcmp(argv[i], "-b")) || (!strcmp(argv[i], "--budget")))
+        {
+            i++;
+            budget = atof(argv[i]) / 100;
+        }
+        if ((!strcmp(argv[i], "-m")) || (!strcmp(argv[i], "--shm")))
+        {
+            i++;
+            shm_name = string(argv[i]);
+        }
+        if ((!strcmp(argv[i], "-t")) || (!strcmp(argv[i], "--trace")))
+        {
+            i++;
+            trace_file = string(argv[i]);
+        }
+        if ((!strcmp(argv[i], "-F")) || (!strcmp(argv[i], "--fleet")))
+        {
+            i++;
+            fleet_addrs.push_back(string(argv[i]));
+        }
+        if ((!strcmp(argv[i], "-S")) || (!strcmp(argv[i], "--send")))
+        {
+            i++;
+            send_addr = string(argv[i]);
+        }
+        if ((!strcmp(argv[i], "-n")) || (!strcmp(argv[i], "--node")))
+        {
+            i++;
+            node_name = string(argv[i]);
+        }
+        if ((!strcmp(argv[i], "-p")) || (!strcmp(argv[i], "--partition")))
+        {
+            i++;
+            if(filter.parse_partitions(argv[i]))
+                return EXIT_FAILURE;
+        }
+        if ((!strcmp(argv[i], "-P")) || (!strcmp(argv[i], "--pid")))
+        {
+            i++;
+            if(filter.parse_processes(argv[i]))
+                return EXIT_FAILURE;
+        }
+        if ((!strcmp(argv[i], "-f")) || (!strcmp(argv[i], "--fields")))
+        {
+            i++;
+            if(filter.parse_fields(argv[i]))
+                return EXIT_FAILURE;
+        }
         if ((!strcmp(argv[i], "-s")) || (!strcmp(argv[i], "--slices")))
         {
             i++;
             string tmp = string(argv[i]);
             size_t pos = tmp.find(":");
             p_slices = tmp.substr(0, pos);
-            slices = tmp.erase(0, pos + 1);
+            slices = mali_mask::parse(tmp.erase(0, pos + 1), true);
         }
         if ((!strcmp(argv[i], "-a")) || (!strcmp(argv[i], "--access_window")))
         {
@@ -217,65 +370,220 @@ int main(int argc, char *argv[])
             string tmp = string(argv[i]);
             size_t pos = tmp.find(":");
             p_aw = tmp.substr(0, pos);
-            aw = tmp.erase(0, pos + 1);
+            aw = mali_mask::parse(tmp.erase(0, pos + 1), true);
+        }
+        if ((!strcmp(argv[i], "-A")) || (!strcmp(argv[i], "--apply")))
+        {
+            i++;
+            layout = string(argv[i]);
+        }
+        if ((!strcmp(argv[i], "-r")) || (!strcmp(argv[i], "--reconcile")))
+        {
+            i++;
+            layout = string(argv[i]);
+            keep_reconciling = true;
         }
         if ((!strcmp(argv[i], "-h")) || (!strcmp(argv[i], "--help")))
         {
             cout << "Arm Mali GPU monitoring tool" << endl;
-            cout << "Usage: ./mali_manager [-h|--help] [-y|--yaml] [-s|--slices PARTITION:SLICES] [-a|--access_window PARTITION:AW]" << endl;
+            cout << "Usage: ./mali_manager [-h|--help] [-y|--yaml] [-u|--update] [-T|--top N] [-b|--budget PCT] [-m|--shm NAME] [-t|--trace FILE]";
+            cout << " [-S|--send ADDR] [-n|--node NAME]";
+            cout << " [-p|--partition LIST] [-P|--pid LIST] [-f|--fields LIST] [-s|--slices PARTITION:SLICES] [-a|--access_window PARTITION:AW]";
+            cout << " [-A|--apply FILE] [-r|--reconcile FILE]";
+            cout << " [-F|--fleet ADDR]" << endl;
             cout << "   Monitoring mode:"                                                                                            << endl;
             cout << "       -h/--help: print this help and exit"                                                                     << endl;
             cout << "       -y/--yaml: output in YAML format"                                                                        << endl;
-            cout << "       -u/--update: automatically update every second"                                                          << endl;
+            cout << "       -u/--update: automatically update, faster around changes and slower in steady state"                     << endl;
+            cout << "       -T/--top: only print the N processes using the most GPU memory across partitions"                        << endl;
+            cout << "       -b/--budget: CPU time budget of automatic updates in % of one core (default 0.5)"                        << endl;
+            cout << "       -m/--shm: publish snapshots to the POSIX shared memory segment NAME (e.g. /gpuman)"                      << endl;
+            cout << "       -t/--trace: stream a Chrome trace event JSON timeline to FILE (e.g. for ui.perfetto.dev)"                << endl;
+            cout << "       -S/--send: stream samples to the fleet aggregator at ADDR (unix:PATH or HOST:PORT)"                      << endl;
+            cout << "       -n/--node: name of this node in the fleet (default: host name)"                                          << endl;
+            cout << "       -p/--partition: only sample partitions of comma separated LIST of names or IDs (e.g. mali0,1)"           << endl;
+            cout << "       -P/--pid: only sample processes of comma separated LIST of PIDs or command globs (e.g. 1234,python*)"    << endl;
+            cout << "       -f/--fields: only sample fields of comma separated LIST (e.g. status,memory), among:"                    << endl;
+            cout << "           gpu (name, ddk_version, system_memory),"                                                             << endl;
+            cout << "           partition (status, slices, access_window, memory, pm),"                                              << endl;
+            cout << "           process (processes, cmd, process_memory, cgroup), all"                                               << endl;
             cout << "   Configuration mode:"                                                                                         << endl;
             cout << "       -s/--slices: assign hex value SLICES to partition PARTITION"                                             << endl;
             cout << "       -a/--access_window: assign hex value AW to partition PARTITION"                                          << endl;
+            cout << "       -A/--apply: apply the partition layout in FILE once, only writing partitions that drifted"               << endl;
+            cout << "       -r/--reconcile: keep partitions at the layout in FILE, checking every second"                            << endl;
+
+            cout << "   Fleet mode:"                                                                                                 << endl;
+            cout << "       -F/--fleet: aggregate samples streamed by nodes to ADDR (unix:PATH or :PORT), can be repeated"           << endl;
 
             return EXIT_SUCCESS;
         }
     }
 
-    device = new printable_mali_gpu(emit_yaml);
+    if(!fleet_addrs.empty())
+    {
+        mali_fleet_aggregator fleet;
+        struct timespec ts, last = {0, 0};
+
+        for(string& i : fleet_addrs)
+        {
+            if(fleet.listen(i))
+                return EXIT_FAILURE;
+        }
+
+        while(1)
+        {
+            fleet.run(100);
+
+            // Redraw the fleet view every second
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            if(ts.tv_sec != last.tv_sec)
+            {
+                cout << "\033[2J";    // clear the screen
+                cout << "\033[1;1H";  // move cursor home
+                cout << fleet << flush;
+                last = ts;
+            }
+        }
+    }
+
+    if(layout != "")
+    {
+        mali_reconciler reconciler;
+        mali_gpu gpu(MALI_FIELD_SLICES | MALI_FIELD_ASSIGNED_AW);
+        bool converged;
+
+        if(reconciler.load(layout))
+            return EXIT_FAILURE;
+
+        reconciler.set_log(&cout);
+
+        while(1)
+        {
+            reconciler.reconcile(gpu);
 
-    if(slices != "" || aw != "")
+            // Converged once the read back layout matches, without pending retries
+            converged = true;
+            for(const mali_desired_partition& d : reconciler.get_desired())
+            {
+                if(d.slices_backoff.failures > 0 || d.aw_backoff.failures > 0)
+                    converged = false;
+            }
+            for(const mali_drift_event& e : reconciler.get_events())
+            {
+                if(e.action == MALI_DRIFT_MISSING)
+                    converged = false;
+            }
+
+            if(!keep_reconciling)
+                return converged ? EXIT_SUCCESS : EXIT_FAILURE;
+
+            sleep(1);
+            gpu.update();
+        }
+    }
+
+    // Filters only apply to monitoring, partitions are configured by index
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+    device = new printable_mali_gpu(p_slices != "" || p_aw != "" ? mali_filter() : filter, emit_yaml);
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+    device->top = top;
+
+    if(p_slices != "" || p_aw != "")
     {
-        if(slices != "")
+        if(p_slices != "")
         {
             if(device->get_partitions()[std::stoi(p_slices)].set_slices(slices))
             {
-                cout << "Failed to assign slice ID(s) [" << hex_to_id(slices) << "] to partition " << p_slices << endl;
+                cout << "Failed to assign slice ID(s) [" << slices.to_ids() << "] to partition " << p_slices << endl;
                 return EXIT_FAILURE;
             }
             else
-                cout << "Successfully assigned slice ID(s) [" << hex_to_id(slices) << "] to partition " << p_slices << endl;
+                cout << "Successfully assigned slice ID(s) [" << slices.to_ids() << "] to partition " << p_slices << endl;
         }
-        if(aw != "")
+        if(p_aw != "")
         {
             if(device->get_partitions()[std::stoi(p_aw)].set_assigned_aw(aw))
             {
-                cout << "Failed to assign access window ID [" << hex_to_id(aw) << "] to partition " << p_aw << endl;
+                cout << "Failed to assign access window ID [" << aw.to_ids() << "] to partition " << p_aw << endl;
                 return EXIT_FAILURE;
             }
             else
-                cout << "Successfully assigned access window ID [" << hex_to_id(aw) << "] to partition " << p_aw << endl;
+                cout << "Successfully assigned access window ID [" << aw.to_ids() << "] to partition " << p_aw << endl;
         }
         return EXIT_SUCCESS;
     }
 
+    if(shm_name != "")
+    {
+        snapshot = new mali_snapshot_writer(shm_name);
+        if(!snapshot->is_open())
+            return EXIT_FAILURE;
+        snapshot->publish(*device);
+    }
+
+    if(trace_file != "")
+    {
+        trace = new mali_trace_writer(trace_file, *device);
+        if(!trace->is_open())
+            return EXIT_FAILURE;
+    }
+
+    if(send_addr != "")
+    {
+        char host[MALI_FLEET_NODE_LEN] = "";
+
+        if(node_name == "")
+        {
+            gethostname(host, sizeof(host) - 1);
+            node_name = host;
+        }
+        sender = new mali_fleet_sender(send_addr, node_name);
+        if(sender->send(*device))
+            cout << "Failed to send samples to " << send_addr << ", retrying on updates" << endl;
+    }
+
     if(auto_update)
     {
+        mali_sampler sampler(budget);
+        bool redraw = true;
+
+        device->sampler = &sampler;
+        // Without uevents (e.g. no netlink permission), periodic rescans still apply
+        device->watch_topology();
+        // Without process events (e.g. no CAP_NET_ADMIN), commands are only read again on rescans
+        device->watch_processes();
+
         while(1)
         {
-            cout << "\033[2J";    // clear the screen
-            cout << "\033[1;1H";  // move cursor home
-            cout << *device;
-            sleep(1);
-            device->update();
+            uint64_t interval = sampler.get_interval();
+
+            // Only re-render when something changed
+            if(redraw)
+            {
+                cout << "\033[2J";    // clear the screen
+                cout << "\033[1;1H";  // move cursor home
+                cout << *device << flush;
+            }
+            sampler.wait(device->get_process_fd());
+            redraw = !sampler.update(*device).empty() || sampler.get_interval() != interval;
+            if(snapshot)
+                snapshot->publish(*device, &sampler);
+            if(trace)
+                trace->record(&sampler);
+            if(sender)
+                sender->send(*device, &sampler);
         }
     }
     else
+    {
+        device->sample_cost = (end.tv_sec - start.tv_sec) * 1000000000ULL + end.tv_nsec - start.tv_nsec;
         cout << *device;
+    }
 
+    delete sender;
+    delete trace;
+    delete snapshot;
     delete device;
 
     return EXIT_SUCCESS;
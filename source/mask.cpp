@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mask.hpp"
+
+
+/*
+ * Returns the mask as a hex value (e.g. "0xf"), "N/A" if invalid
+ */
+string mali_mask::to_string() const
+{
+    char buf[MALI_MASK_MAX_IDS / 4 + 3];
+
+    if (format(buf, sizeof(buf)) == 0)
+        return "N/A";
+
+    return string(buf);
+}
+
+/*
+ * Returns the list of IDs set in the mask (e.g. "0 1 2 3")
+ */
+string mali_mask::to_ids() const
+{
+    string ret = "";
+
+    for (unsigned id : *this)
+    {
+        if (!ret.empty())
+            ret += " ";
+        ret += std::to_string(id);
+    }
+
+    return ret;
+}
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _MASK_H_
+#define _MASK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#define MALI_MASK_MAX_IDS 64
+
+using namespace std;
+
+/*
+ * 64-bit mask of slice or access window IDs, bit n set meaning ID n is used.
+ * A mask parsed from an unreadable or malformed value is invalid.
+ */
+class mali_mask
+{
+    private:
+        uint64_t bits;
+        bool valid;
+
+    public:
+        // Iterates over the IDs set in the mask, in ascending order
+        class iterator
+        {
+            private:
+                uint64_t rest;
+
+            public:
+                constexpr iterator(uint64_t r) : rest(r) {};
+                constexpr unsigned operator*() const { return __builtin_ctzll(rest); };
+                constexpr iterator& operator++() { rest &= rest - 1; return *this; };
+                constexpr bool operator!=(const iterator& o) const { return rest != o.rest; };
+        };
+
+        // Getter
+        constexpr uint64_t get_bits() const { return bits; };
+        constexpr bool is_valid() const { return valid; };
+        constexpr bool empty() const { return bits == 0; };
+        constexpr int count() const { return __builtin_popcountll(bits); };
+        constexpr bool test(unsigned id) const { return id < MALI_MASK_MAX_IDS && (bits >> id) & 1; };
+        constexpr iterator begin() const { return iterator(bits); };
+        constexpr iterator end() const { return iterator(0); };
+        // Set operations
+        constexpr bool overlaps(mali_mask m) const { return (bits & m.bits) != 0; };
+        constexpr mali_mask operator|(mali_mask m) const { return mali_mask(bits | m.bits, valid && m.valid); };
+        constexpr mali_mask operator&(mali_mask m) const { return mali_mask(bits & m.bits, valid && m.valid); };
+        constexpr bool operator==(mali_mask m) const { return bits == m.bits && valid == m.valid; };
+        constexpr bool operator!=(mali_mask m) const { return !(*this == m); };
+        // Parse / format
+        static constexpr mali_mask parse(const char *s, size_t len, bool require_prefix = false);
+        static mali_mask parse(const string& s, bool require_prefix = false) { return parse(s.data(), s.length(), require_prefix); };
+        constexpr size_t format(char *buf, size_t len) const;
+        string to_string() const;
+        string to_ids() const;
+        // Constructor
+        constexpr mali_mask() : bits(0), valid(false) {};
+        constexpr explicit mali_mask(uint64_t b, bool v = true) : bits(b), valid(v) {};
+};
+
+/*
+ * Parses hex value s (e.g. "0xF"), surrounding white spaces are ignored
+ * Returns an invalid mask if s is not a hex value fitting in 64 bits
+ */
+constexpr mali_mask mali_mask::parse(const char *s, size_t len, bool require_prefix)
+{
+    size_t i = 0, digits = 0;
+    uint64_t b = 0;
+
+    while (len > 0 && (s[len - 1] == ' ' || s[len - 1] == '\n' || s[len - 1] == '\t'))
+        len--;
+    while (i < len && (s[i] == ' ' || s[i] == '\t'))
+        i++;
+
+    if (i + 1 < len && s[i] == '0' && (s[i + 1] == 'x' || s[i + 1] == 'X'))
+        i += 2;
+    else if (require_prefix)
+        return mali_mask();
+
+    for (; i < len; i++, digits++)
+    {
+        char c = s[i];
+        uint64_t d = 0;
+
+        if (c >= '0' && c <= '9')
+            d = c - '0';
+        else if (c >= 'a' && c <= 'f')
+            d = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            d = c - 'A' + 10;
+        else
+            return mali_mask();
+
+        // Skip leading zeros so they don't count against the 64-bit limit
+        if (b == 0 && d == 0)
+            continue;
+        if (b >> 60)
+            return mali_mask();
+
+        b = (b << 4) | d;
+    }
+
+    if (digits == 0)
+        return mali_mask();
+
+    return mali_mask(b);
+}
+
+/*
+ * Formats the mask as a NUL terminated hex value (e.g. "0xf") into buf
+ * Returns the length of the formatted value, 0 if the mask is invalid or
+ * buf is too small
+ */
+constexpr size_t mali_mask::format(char *buf, size_t len) const
+{
+    size_t n = 1;
+    uint64_t b = bits;
+
+    if (!valid)
+        return 0;
+
+    while (b >>= 4)
+        n++;
+
+    if (len < n + 3)
+        return 0;
+
+    buf[0] = '0';
+    buf[1] = 'x';
+    buf[n + 2] = '\0';
+
+    for (size_t i = 0; i < n; i++)
+    {
+        unsigned d = (bits >> (4 * i)) & 0xF;
+
+        buf[n + 1 - i] = d < 10 ? '0' + d : 'a' + d - 10;
+    }
+
+    return n + 2;
+}
+
+#endif // _MASK_H_
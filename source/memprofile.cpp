@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstring>
+
+#include "memprofile.hpp"
+#include "utils.hpp"
+
+
+/*
+ * Returns the size of category name in bytes, 0 if there is none
+ */
+uint64_t mali_mem_profile::get_size(const string& name) const
+{
+    for (const mali_mem_category& i : categories)
+    {
+        if (i.name == name)
+            return i.size;
+    }
+
+    return 0;
+}
+
+/*
+ * Adds the categories of the mem_profile file at path, streamed line by
+ * line. Only channel totals are used:
+ *   Channel: <name> (Total memory: <bytes>)
+ * histogram lines in between are skipped.
+ * Returns false if the file cannot be read
+ */
+bool mali_mem_profile::add_context(const char *path)
+{
+    mali_line_reader reader(path);
+    const char *line, *p, *end, *sep, *num;
+    size_t len, name_len;
+    uint64_t size;
+    vector<mali_mem_category>::iterator it;
+
+    if (!reader.is_open())
+        return false;
+
+    contexts++;
+
+    while (reader.next(line, len))
+    {
+        end = line + len;
+        p = line;
+
+        while (p < end && (*p == ' ' || *p == '\t'))
+            p++;
+
+        if ((size_t)(end - p) < 9 || memcmp(p, "Channel: ", 9) != 0)
+            continue;
+        p += 9;
+
+        sep = static_cast<const char *>(memmem(p, end - p, " (Total memory: ", 16));
+        if (sep == NULL)
+            continue;
+
+        num = sep + 16;
+
+        if (!parse_number(num, end, size))
+            continue;
+
+        total += size;
+
+        // Categories are few, a linear search beats hashing
+        name_len = sep - p;
+        it = categories.begin();
+
+        while (it != categories.end() && (it->name.length() != name_len || memcmp(it->name.data(), p, name_len) != 0))
+            it++;
+
+        if (it == categories.end())
+            categories.push_back(mali_mem_category{ string(p, name_len), size });
+        else
+            it->size += size;
+    }
+
+    return true;
+}
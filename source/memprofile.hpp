@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _MEMPROFILE_H_
+#define _MEMPROFILE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*
+ * Memory of one allocation category (a "channel" of the DDK memory
+ * profile, e.g. "Default Heap")
+ */
+struct mali_mem_category
+{
+    string name;
+    uint64_t size; // in bytes
+};
+
+/*
+ * Breakdown of GPU memory by allocation category, summed over the
+ * contexts of a process, from kbase ctx/<pid>_<tid>/mem_profile files
+ */
+class mali_mem_profile
+{
+    private:
+        vector<mali_mem_category> categories; // in order of first appearance
+        uint64_t total;    // in bytes
+        uint32_t contexts; // contexts read
+
+    public:
+        // Getter
+        const vector<mali_mem_category>& get_categories() const { return categories; };
+        uint64_t get_total() const { return total; };
+        uint32_t get_contexts() const { return contexts; };
+        bool empty() const { return contexts == 0; };
+        uint64_t get_size(const string& name) const;
+        // Setter
+        bool add_context(const char *path);
+        void clear() { categories.clear(); total = 0; contexts = 0; };
+        // Constructor
+        mali_mem_profile() : total(0), contexts(0) {};
+};
+
+#endif // _MEMPROFILE_H_
@@ -22,17 +22,67 @@
  * SOFTWARE.
  */
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <sys/stat.h>
+
 #include "partition.hpp"
 #include "utils.hpp"
 
 
+/*
+ * Orders processes by PID
+ */
+static bool pid_less(const mali_process& a, const mali_process& b)
+{
+    return a.get_pid() < b.get_pid();
+}
+
+/*
+ * Returns true if memory moved by more than epsilon kB since reported
+ */
+static bool memory_changed(int64_t reported, int64_t current, uint64_t epsilon)
+{
+    return (uint64_t)llabs(current - reported) > epsilon;
+}
+
+/*
+ * Resolve slices and access window paths from system
+ * This walks the platform devices, so it is only done on first use
+ */
+void mali_partition::set_config_paths()
+{
+    string partitions_path = find_file(MALI_DEVICE_PATH, "partitions");
+
+    slices_path = partitions_path + "/partition" + to_string(partition_id) + "/active_slices";
+    aw_path = partitions_path + "/partition" + to_string(partition_id) + "/assigned_access_windows";
+}
+
+/*
+ * Reads the decimal number at the start of file fp into v
+ * Returns false if the file could not be read or holds no number
+ */
+static bool read_number(const string& fp, uint64_t& v)
+{
+    char buf[32];
+    const char *p = buf;
+    ssize_t len = read_file(fp.c_str(), buf, sizeof(buf));
+
+    return len > 0 && parse_number(p, buf + len, v);
+}
+
 /*
  * Set partition status from system
  */
 void mali_partition::set_status()
 {
-    string status_f = string(MALI_CLASS_PATH) + "/" + partition_name + "/device/power/runtime_status";
-    status = get_file_content(status_f);
+    char buf[32];
+    ssize_t len = read_file(status_path.c_str(), buf, sizeof(buf));
+
+    status = len < 0 ? MALI_STATUS_UNKNOWN : mali_status_parse(buf, len);
+    loaded |= MALI_FIELD_STATUS;
 }
 
 /*
@@ -40,29 +90,29 @@ void mali_partition::set_status()
  */
 void mali_partition::set_slices()
 {
-    string gpuslices_f;
-    string partition_id = partition_name;
+    char buf[32];
+    ssize_t len;
+
+    if (slices_path.empty())
+        set_config_paths();
 
-    slices = "N/A";
-    partition_id.replace(0, 4, "");
-    gpuslices_f = find_file(MALI_DEVICE_PATH, "partitions") + "/partition" + partition_id + "/active_slices";
-    slices = get_file_content(gpuslices_f);
+    len = read_file(slices_path.c_str(), buf, sizeof(buf));
+    slices = len < 0 ? mali_mask() : mali_mask::parse(buf, len);
+    loaded |= MALI_FIELD_SLICES;
 }
 
 /*
  * Set partition slices from argument
  */
-int mali_partition::set_slices(string s)
+int mali_partition::set_slices(mali_mask s)
 {
-    string gpuslices_f;
-    string partition_id = partition_name;
+    if (slices_path.empty())
+        set_config_paths();
 
-    // Argument should be hex value
-    if (s.find("0x") != string::npos)
+    // Argument should be a valid hex value
+    if (s.is_valid())
     {
-        partition_id.replace(0, 4, "");
-        gpuslices_f = find_file(MALI_DEVICE_PATH, "partitions") + "/partition" + partition_id + "/active_slices";
-        set_file_content(s, gpuslices_f);
+        set_file_content(s.to_string(), slices_path);
     }
     else
     {
@@ -79,30 +129,29 @@ int mali_partition::set_slices(string s)
  */
 void mali_partition::set_assigned_aw()
 {
-    string gpuaw_f;
-    string partition_id = partition_name;
+    char buf[32];
+    ssize_t len;
 
-    assigned_aw = "N/A";
-    partition_id.replace(0, 4, "");
-    gpuaw_f = find_file(MALI_DEVICE_PATH, "partitions") + "/partition" + partition_id + "/assigned_access_windows";
+    if (aw_path.empty())
+        set_config_paths();
 
-    assigned_aw = get_file_content(gpuaw_f);
+    len = read_file(aw_path.c_str(), buf, sizeof(buf));
+    assigned_aw = len < 0 ? mali_mask() : mali_mask::parse(buf, len);
+    loaded |= MALI_FIELD_ASSIGNED_AW;
 }
 
 /*
  * Set assigned window from argument
  */
-int mali_partition::set_assigned_aw(string aw)
+int mali_partition::set_assigned_aw(mali_mask aw)
 {
-    string gpuaw_f;
-    string partition_id = partition_name;
+    if (aw_path.empty())
+        set_config_paths();
 
-    // Argument should be hex value
-    if (aw.find("0x") != string::npos)
+    // Argument should be a valid hex value
+    if (aw.is_valid())
     {
-        partition_id.replace(0, 4, "");
-        gpuaw_f = find_file(MALI_DEVICE_PATH, "partitions") + "/partition" + partition_id + "/assigned_access_windows";
-        set_file_content(aw, gpuaw_f);
+        set_file_content(aw.to_string(), aw_path);
     }
     else
     {
@@ -115,85 +164,614 @@ int mali_partition::set_assigned_aw(string aw)
 }
 
 /*
- * Set memory usage from system
+ * Set memory usage of the partition, and of its processes if they are
+ * listed, from system
+ * gpu_memory lists the partition pages first, then the pages of each
+ * context along with the PID owning it
  */
 void mali_partition::set_memory_usage()
 {
-    string gpu_mem_f = string(MALI_DBG_PATH) + "/" + partition_name + "/gpu_memory";
-    string gpu_mempages;
-    fstream file_fs;
+    mali_line_reader reader(gpu_memory_path.c_str());
+    const char *line, *p, *end;
+    size_t len;
+    uint64_t pid, pages;
+    // Processes listed in a previous epoch are not attributed memory
+    bool attribute = (loaded & MALI_FIELD_PROCESSES) != 0;
 
-    file_fs.open(gpu_mem_f, fstream::in);
+    loaded |= MALI_FIELD_MEMORY;
+    if (attribute)
+        loaded |= MALI_FIELD_PROCESS_MEMORY;
 
-    if (file_fs.is_open())
+    if (!reader.is_open())
+        return;
+
+    memory_usage = 0;
+
+    while (reader.next(line, len))
     {
-        while (getline(file_fs, gpu_mempages))
+        end = line + len;
+
+        // Partition total: "<partition name> <pages>"
+        if (len > partition_name.length() && memcmp(line, partition_name.data(), partition_name.length()) == 0
+            && isspace(line[partition_name.length()]))
         {
-            if (gpu_mempages.find(partition_name) != string::npos)
+            p = line + partition_name.length();
+            if (parse_number(p, end, pages))
+                memory_usage = pages * 4; // in kB
+            if (!attribute)
+                break;
+            continue;
+        }
+
+        // Context: "... pid: <pid> <pages>"
+        p = static_cast<const char *>(memmem(line, len, "pid:", 4));
+        if (!attribute || p == NULL)
+            continue;
+        p += 4;
+
+        if (parse_number(p, end, pid) && parse_number(p, end, pages))
+        {
+            vector<mali_process>::iterator it = lower_bound(processes.begin(), processes.end(),
+                                                            mali_process(partition_id, pid), pid_less);
+
+            // A process may own several contexts
+            if (it != processes.end() && it->pid == (pid_t)pid)
+                it->memory_usage = (it->memory_usage < 0 ? 0 : it->memory_usage) + pages * 4; // in kB
+        }
+    }
+}
+
+/*
+ * Set runtime PM counters and devfreq state from system, adding a sample
+ * to the PM history
+ */
+void mali_partition::set_pm_counters()
+{
+    uint64_t v;
+    struct timespec ts;
+    mali_pm_sample s;
+
+    if (!devfreq_resolved)
+    {
+        string devfreq_dir = string(MALI_CLASS_PATH) + "/" + partition_name + "/device/devfreq";
+        mali_dir dir(devfreq_dir.c_str());
+        const char *ent;
+
+        while ((ent = dir.next()) != NULL)
+        {
+            if (ent[0] != '.')
             {
-                gpu_mempages.replace(0, gpu_mempages.find(partition_name)+ partition_name.length(), "");
+                devfreq_freq_path = devfreq_dir + "/" + ent + "/cur_freq";
+                devfreq_load_path = devfreq_dir + "/" + ent + "/load";
                 break;
             }
         }
 
-        if (gpu_mempages != "")
-            memory_usage = stoi(gpu_mempages) * 4; // in kB
-        else
-            memory_usage = 0;
+        devfreq_resolved = true;
     }
 
-    file_fs.close();
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    s.timestamp = (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+    s.status = get_status();
+    s.valid = read_number(active_time_path, s.active_time) && read_number(suspended_time_path, s.suspended_time);
+
+    if (s.valid)
+        pm_history.add(s);
+
+    frequency = 0;
+    devfreq_load = -1;
+
+    if (!devfreq_freq_path.empty())
+    {
+        if (read_number(devfreq_freq_path, v))
+            frequency = v;
+        // Where available, load reads as "<load>@<frequency>Hz"
+        if (read_number(devfreq_load_path, v))
+            devfreq_load = v;
+    }
+
+    loaded |= MALI_FIELD_PM_COUNTERS;
 }
 
 /*
  * Set running processes from system
+ * Contexts are only listed again if the partition was invalidated or a
+ * context was created or released since the last listing
  */
 void mali_partition::set_processes()
 {
-    DIR *dir_ctx;
-    struct dirent *ent_ctx;
-    string path_ctx = string(MALI_DBG_PATH) + "/" + partition_name + "/ctx";
+    struct stat st;
+    struct timespec now;
+    bool changed = true;
+
+    // Contexts are subdirectories of ctx, its link count and modification time follow them
+    if (stat(ctx_path.c_str(), &st) == 0)
+    {
+        changed = ctx_racy || st.st_nlink != ctx_nlink || st.st_mtim.tv_sec != ctx_mtime.tv_sec
+               || st.st_mtim.tv_nsec != ctx_mtime.tv_nsec;
+        ctx_nlink = st.st_nlink;
+        ctx_mtime = st.st_mtim;
+
+        // A change within the same tick as this listing would leave the time as is, the next update lists again
+        clock_gettime(CLOCK_REALTIME, &now);
+        ctx_racy = (now.tv_sec - st.st_mtim.tv_sec) * 1000 + (now.tv_nsec - st.st_mtim.tv_nsec) / 1000000
+                   < MALI_CTX_TICK_MS;
+    }
+
+    if (changed || processes_dirty)
+        list_processes();
+    else
+        keep_processes();
+}
+
+/*
+ * Returns process pid of the current snapshot, NULL if there is none
+ */
+mali_process *mali_partition::find_process(pid_t pid)
+{
+    vector<mali_process>::iterator it = lower_bound(processes.begin(), processes.end(),
+                                                    mali_process(partition_id, pid), pid_less);
+
+    return it != processes.end() && it->pid == pid ? &*it : NULL;
+}
+
+/*
+ * Returns true if process pid was filtered out of the current snapshot by
+ * its command
+ */
+bool mali_partition::is_rejected(pid_t pid) const
+{
+    vector<pair<pid_t, uint64_t>>::const_iterator it = lower_bound(rejected.begin(), rejected.end(),
+                                                                    make_pair(pid, (uint64_t)0));
+
+    return it != rejected.end() && it->first == pid;
+}
+
+/*
+ * Carries the processes of the previous epoch over, without listing
+ * contexts
+ */
+void mali_partition::keep_processes()
+{
+    previous_processes = processes;
+    loaded = (loaded | MALI_FIELD_PROCESSES) & ~MALI_FIELD_PROCESS_MEMORY;
+
+    // Commands and cgroups stay valid, memory is attributed again
+    for (mali_process& i : processes)
+        i.memory_usage = -1;
+}
+
+/*
+ * Lists running processes from the contexts of the partition
+ * Commands of processes already running in the previous snapshot are
+ * carried over instead of being read again, unless refreshed (see
+ * refresh_processes() and refresh_process()); other commands and memory
+ * usage are read by set_process_cmds() and set_memory_usage()
+ */
+void mali_partition::list_processes()
+{
+    mali_dir dir_ctx(ctx_path.c_str());
+    const char *ent_ctx;
+    mali_arena& cur_arena = arenas[arena ^ 1];
+    vector<mali_process>::iterator prev;
+    vector<pair<pid_t, uint64_t>>::iterator ctx, prev_ctx;
+
+    arena ^= 1;
+    cur_arena.reset();
+    processes_dirty = false;
+    previous_processes.swap(processes);
+    processes.clear();
+    previous_contexts.swap(contexts);
+    contexts.clear();
+    loaded = (loaded | MALI_FIELD_PROCESSES)
+           & ~(MALI_FIELD_PROCESS_CMD | MALI_FIELD_PROCESS_MEMORY | MALI_FIELD_PROCESS_CGROUP);
 
     // get context information if available
-    if ((dir_ctx = opendir(path_ctx.c_str())) != NULL)
+    while ((ent_ctx = dir_ctx.next()) != NULL)
     {
-        while ((ent_ctx = readdir(dir_ctx)) != NULL)
+        const char *p = ent_ctx;
+        uint64_t pid;
+
+        // entries are named <pid>_<thread id>, get rid of ., .. and defaults
+        if (!parse_number(p, ent_ctx + strlen(ent_ctx), pid) || *p != '_')
+            continue;
+
+        // Without command line globs, filtered out processes cost nothing more
+        if (filter != NULL && !filter->filters_cmds() && !filter->match_pid(pid))
+            continue;
+
+        processes.push_back(mali_process(partition_id, pid, dir_ctx.get_ino()));
+    }
+
+    // a process may own several contexts, a new one is identified by its oldest one
+    sort(processes.begin(), processes.end(),
+         [](const mali_process& a, const mali_process& b) { return a.pid < b.pid || (a.pid == b.pid && a.ctx_ino < b.ctx_ino); });
+    for (mali_process& i : processes)
+        contexts.push_back(make_pair(i.pid, i.ctx_ino));
+    processes.erase(unique(processes.begin(), processes.end(),
+                           [](const mali_process& a, const mali_process& b) { return a.pid == b.pid; }),
+                    processes.end());
+
+    prev = previous_processes.begin();
+    ctx = contexts.begin();
+    prev_ctx = previous_contexts.begin();
+    sort(exec_pids.begin(), exec_pids.end());
+
+    for (mali_process& i : processes)
+    {
+        bool same = false;
+
+        while (prev != previous_processes.end() && prev->pid < i.pid)
+            prev++;
+        while (ctx != contexts.end() && ctx->first < i.pid)
+            ctx++;
+        while (prev_ctx != previous_contexts.end() && prev_ctx->first < i.pid)
+            prev_ctx++;
+
+        // The process is the same as long as it keeps one of its contexts
+        for (vector<pair<pid_t, uint64_t>>::iterator c = ctx, p = prev_ctx;
+             !same && c != contexts.end() && c->first == i.pid && p != previous_contexts.end() && p->first == i.pid;)
         {
-            string pid_thid = ent_ctx->d_name;                   // get pid and thread id
-            string pid = pid_thid.substr(0, pid_thid.find("_")); // get pid
-            // get rid of ., .. and default
-            if (is_number(pid))
-            {
-                processes.push_back(mali_process(partition_name, pid));
-            }
+            if (c->second == p->second)
+                same = true;
+            else if (c->second < p->second)
+                c++;
+            else
+                p++;
+        }
+
+        // Same PID but none of its contexts: the PID was reused, nothing is carried over
+        if (same && prev != previous_processes.end() && prev->pid == i.pid)
+        {
+            bool exec = refresh_cmds || binary_search(exec_pids.begin(), exec_pids.end(), i.pid);
+
+            i.ctx_ino = prev->ctx_ino;
+            if (prev->cmd != NULL && !exec)
+                i.cmd = cur_arena.store(prev->cmd, strlen(prev->cmd));
+            if (prev->cgroup != NULL && !exec)
+                i.cgroup = cur_arena.store(prev->cgroup, strlen(prev->cgroup));
+            i.reported_memory_usage = prev->reported_memory_usage;
+        }
+    }
+
+    if (filter != NULL && filter->filters_cmds())
+        filter_processes();
+
+    refresh_cmds = false;
+    exec_pids.clear();
+}
+
+/*
+ * Drop listed processes matching neither the PIDs nor the command line
+ * globs of the filter. Commands are only read for contexts not seen in
+ * the previous snapshot and for refreshed processes, other rejected
+ * contexts are remembered by PID and inode
+ */
+void mali_partition::filter_processes()
+{
+    vector<mali_process>::iterator out = processes.begin();
+
+    previous_rejected.swap(rejected);
+    rejected.clear();
+
+    for (mali_process& i : processes)
+    {
+        bool keep = i.cmd != NULL || filter->match_pid(i.pid);
+
+        if (!keep && (refresh_cmds || binary_search(exec_pids.begin(), exec_pids.end(), i.pid)
+                      || !binary_search(previous_rejected.begin(), previous_rejected.end(), make_pair(i.pid, i.ctx_ino))))
+        {
+            i.set_cmd(arenas[arena]);
+            keep = filter->match_cmd(i.cmd);
         }
 
-        closedir(dir_ctx);
+        if (keep)
+            *out++ = i;
+        else
+            rejected.push_back(make_pair(i.pid, i.ctx_ino));
+    }
+
+    processes.erase(out, processes.end());
+    sort(rejected.begin(), rejected.end());
+}
+
+/*
+ * Set commands of listed processes not carried over from the previous
+ * snapshot, from system
+ */
+void mali_partition::set_process_cmds()
+{
+    for (mali_process& i : processes)
+    {
+        if (i.cmd == NULL)
+            i.set_cmd(arenas[arena]);
+    }
+
+    loaded |= MALI_FIELD_PROCESS_CMD;
+}
+
+/*
+ * Set cgroups of listed processes not carried over from the previous
+ * snapshot, from system
+ */
+void mali_partition::set_process_cgroups()
+{
+    for (mali_process& i : processes)
+    {
+        if (i.cgroup == NULL)
+            i.set_cgroup(arenas[arena]);
+    }
+
+    loaded |= MALI_FIELD_PROCESS_CGROUP;
+}
+
+/*
+ * Rebuild per-cgroup totals from the processes of the current epoch
+ * When cgroups are declared, totals are then kept up to date by update()
+ */
+void mali_partition::set_cgroups()
+{
+    load(MALI_FIELD_PROCESSES | MALI_FIELD_PROCESS_MEMORY | MALI_FIELD_PROCESS_CGROUP);
+    cgroups.clear();
+
+    for (mali_process& i : processes)
+        mali_cgroup_account(cgroups, i.cgroup, i.memory_usage < 0 ? 0 : i.memory_usage, 1);
+
+    cgroups_valid = true;
+}
+
+/*
+ * Returns the memory profile of process pid, summed over its contexts
+ * Profiles are only read when asked for, and cached until the next update
+ */
+const mali_mem_profile& mali_partition::get_mem_profile(pid_t pid)
+{
+    map<pid_t, mali_mem_profile>::iterator it;
+
+    if (mem_profiles_epoch != epoch)
+    {
+        mem_profiles.clear();
+        mem_profiles_epoch = epoch;
+    }
+
+    it = mem_profiles.find(pid);
+
+    if (it == mem_profiles.end())
+    {
+        mali_dir dir_ctx(ctx_path.c_str());
+        const char *ent_ctx;
+        mali_mem_profile& profile = mem_profiles[pid];
+
+        // contexts of pid are named <pid>_<thread id>
+        while ((ent_ctx = dir_ctx.next()) != NULL)
+        {
+            const char *p = ent_ctx;
+            uint64_t ctx_pid;
+
+            if (parse_number(p, ent_ctx + strlen(ent_ctx), ctx_pid) && *p == '_' && (pid_t)ctx_pid == pid)
+                profile.add_context((ctx_path + "/" + ent_ctx + "/mem_profile").c_str());
+        }
+
+        return profile;
+    }
+
+    return it->second;
+}
+
+/*
+ * Notifies the observer of the fields read since before, if any
+ */
+void mali_partition::notify(uint32_t& before)
+{
+    if (observer != NULL && (loaded & ~before))
+        (*observer)(*this, loaded & ~before);
+
+    before = loaded;
+}
+
+/*
+ * Read fields f not read yet during the current epoch
+ * The observer is notified after each read, so slow reads do not delay
+ * fields read before them
+ */
+void mali_partition::load(uint32_t f)
+{
+    uint32_t before = loaded;
+
+    if ((f & MALI_FIELD_STATUS) && !(loaded & MALI_FIELD_STATUS))
+    {
+        set_status();
+        notify(before);
+    }
+    if ((f & MALI_FIELD_SLICES) && !(loaded & MALI_FIELD_SLICES))
+    {
+        set_slices();
+        notify(before);
+    }
+    if ((f & MALI_FIELD_ASSIGNED_AW) && !(loaded & MALI_FIELD_ASSIGNED_AW))
+    {
+        set_assigned_aw();
+        notify(before);
+    }
+    if ((f & MALI_FIELD_PM_COUNTERS) && !(loaded & MALI_FIELD_PM_COUNTERS))
+    {
+        set_pm_counters();
+        notify(before);
+    }
+    if ((f & MALI_FIELD_PROCESS_ALL) && !(loaded & MALI_FIELD_PROCESSES))
+    {
+        set_processes();
+        notify(before);
+    }
+    if ((f & MALI_FIELD_PROCESS_CMD) && !(loaded & MALI_FIELD_PROCESS_CMD))
+    {
+        set_process_cmds();
+        notify(before);
+    }
+    if ((f & MALI_FIELD_PROCESS_CGROUP) && !(loaded & MALI_FIELD_PROCESS_CGROUP))
+    {
+        set_process_cgroups();
+        notify(before);
+    }
+    // Process memory comes along with the partition memory
+    if (((f & MALI_FIELD_MEMORY) && !(loaded & MALI_FIELD_MEMORY))
+        || ((f & MALI_FIELD_PROCESS_MEMORY) && !(loaded & MALI_FIELD_PROCESS_MEMORY)))
+    {
+        set_memory_usage();
+        notify(before);
     }
 }
 
 /*
  * Constructor
+ * Only fields f are read, other fields are read on first access, and only
+ * processes matching flt are listed if set
  */
-mali_partition::mali_partition(string part)
+mali_partition::mali_partition(string part, uint32_t f, const mali_filter *flt)
 {
-    partition_name = part; 
-    set_status();
-    set_slices();
-    set_assigned_aw();
-    set_memory_usage();
-    set_processes();
+    partition_name = part;
+    partition_id = strtoul(part.c_str() + 4, NULL, 10);
+    fields = f;
+    loaded = 0;
+    filter = flt;
+    observer = NULL;
+    processes_dirty = true;
+    refresh_cmds = false;
+    ctx_nlink = 0;
+    ctx_mtime = {0, 0};
+    ctx_racy = false;
+    epoch = 0;
+    mem_profiles_epoch = 0;
+    cgroups_valid = false;
+    status_path = string(MALI_CLASS_PATH) + "/" + partition_name + "/device/power/runtime_status";
+    gpu_memory_path = string(MALI_DBG_PATH) + "/" + partition_name + "/gpu_memory";
+    ctx_path = string(MALI_DBG_PATH) + "/" + partition_name + "/ctx";
+    active_time_path = string(MALI_CLASS_PATH) + "/" + partition_name + "/device/power/runtime_active_time";
+    suspended_time_path = string(MALI_CLASS_PATH) + "/" + partition_name + "/device/power/runtime_suspended_time";
+    devfreq_resolved = false;
+    frequency = 0;
+    devfreq_load = -1;
+    status = MALI_STATUS_UNKNOWN;
+    memory_usage = 0;
+    arena = 0;
+
+    // Per-cgroup totals are maintained from process memory changes
+    if (fields & MALI_FIELD_PROCESS_CGROUP)
+        fields |= MALI_FIELD_PROCESSES | MALI_FIELD_PROCESS_MEMORY;
+
+    load(fields);
+    reported_memory_usage = memory_usage;
+
+    for (mali_process& i : processes)
+        i.reported_memory_usage = i.memory_usage;
+
+    if (fields & MALI_FIELD_PROCESS_CGROUP)
+        set_cgroups();
 }
 
 /*
- * Update status
+ * Start a new epoch and add what changed in declared fields since the
+ * previous update to changes
+ * Memory changes are only reported once they exceed memory_epsilon kB
  */
-void mali_partition::update()
+void mali_partition::update(mali_change_set& changes, uint64_t memory_epsilon)
 {
-    set_status();
-    set_slices();
-    set_assigned_aw();
-    set_memory_usage();
-    processes.clear();
-    set_processes();
-}
\ No newline at end of file
+    mali_status old_status = status;
+    mali_mask old_slices = slices, old_aw = assigned_aw;
+    vector<mali_process>::iterator o, n;
+
+    epoch++;
+    loaded = 0;
+    load(fields);
+
+    if (!(fields & MALI_FIELD_PROCESS_CGROUP))
+        cgroups_valid = false;
+
+    if ((fields & MALI_FIELD_STATUS) && status != old_status)
+    {
+        mali_change c(MALI_CHANGE_STATUS, partition_id);
+        c.old_status = old_status;
+        c.new_status = status;
+        changes.add(c);
+    }
+    if ((fields & MALI_FIELD_SLICES) && slices != old_slices)
+    {
+        mali_change c(MALI_CHANGE_SLICES, partition_id);
+        c.old_mask = old_slices;
+        c.new_mask = slices;
+        changes.add(c);
+    }
+    if ((fields & MALI_FIELD_ASSIGNED_AW) && assigned_aw != old_aw)
+    {
+        mali_change c(MALI_CHANGE_ASSIGNED_AW, partition_id);
+        c.old_mask = old_aw;
+        c.new_mask = assigned_aw;
+        changes.add(c);
+    }
+    if ((fields & MALI_FIELD_MEMORY) && memory_changed(reported_memory_usage, memory_usage, memory_epsilon))
+    {
+        mali_change c(MALI_CHANGE_PARTITION_MEMORY, partition_id);
+        c.old_memory = reported_memory_usage;
+        c.new_memory = memory_usage;
+        changes.add(c);
+        reported_memory_usage = memory_usage;
+    }
+
+    if (!(fields & MALI_FIELD_PROCESSES))
+        return;
+
+    // Both lists are sorted by PID, a reused PID is another process
+    o = previous_processes.begin();
+    n = processes.begin();
+
+    while (o != previous_processes.end() || n != processes.end())
+    {
+        bool same = o != previous_processes.end() && n != processes.end() && o->pid == n->pid;
+
+        if (n == processes.end() || (o != previous_processes.end() && o->pid < n->pid)
+            || (same && o->ctx_ino != n->ctx_ino))
+        {
+            mali_change c(MALI_CHANGE_PROCESS_EXITED, partition_id, o->pid);
+            c.old_memory = o->memory_usage;
+            changes.add(c);
+            if (fields & MALI_FIELD_PROCESS_CGROUP)
+                mali_cgroup_account(cgroups, o->cgroup, -max<int64_t>(o->memory_usage, 0), -1);
+            o++;
+        }
+        else if (o == previous_processes.end() || n->pid < o->pid)
+        {
+            mali_change c(MALI_CHANGE_PROCESS_ARRIVED, partition_id, n->pid);
+            c.new_memory = n->memory_usage;
+            changes.add(c);
+            n->reported_memory_usage = n->memory_usage;
+            if (fields & MALI_FIELD_PROCESS_CGROUP)
+                mali_cgroup_account(cgroups, n->cgroup, max<int64_t>(n->memory_usage, 0), 1);
+            n++;
+        }
+        else
+        {
+            // A refreshed cgroup may differ, the process then moves
+            if ((fields & MALI_FIELD_PROCESS_CGROUP) && strcmp(o->get_cgroup(), n->get_cgroup()) != 0)
+            {
+                mali_cgroup_account(cgroups, o->cgroup, -max<int64_t>(o->memory_usage, 0), -1);
+                mali_cgroup_account(cgroups, n->cgroup, max<int64_t>(n->memory_usage, 0), 1);
+            }
+            else if (fields & MALI_FIELD_PROCESS_CGROUP)
+                mali_cgroup_account(cgroups, n->cgroup, max<int64_t>(n->memory_usage, 0)
+                                                        - max<int64_t>(o->memory_usage, 0), 0);
+
+            if ((fields & MALI_FIELD_PROCESS_MEMORY)
+                && memory_changed(n->reported_memory_usage, n->memory_usage, memory_epsilon))
+            {
+                mali_change c(MALI_CHANGE_PROCESS_MEMORY, partition_id, n->pid);
+                c.old_memory = n->reported_memory_usage;
+                c.new_memory = n->memory_usage;
+                changes.add(c);
+                n->reported_memory_usage = n->memory_usage;
+            }
+
+            o++;
+            n++;
+        }
+    }
+}
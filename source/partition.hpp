@@ -25,49 +25,150 @@
 #ifndef _PARTITION_H_
 #define _PARTITION_H_
 
+#include <functional>
+#include <map>
 #include <string>
+#include <utility>
 #include <vector>
+#include <ctime>
 #include <dirent.h>
+#include <sys/types.h>
 #include <unistd.h>
 
+#include "cgroup.hpp"
+#include "changes.hpp"
+#include "fields.hpp"
+#include "filter.hpp"
+#include "mask.hpp"
+#include "memprofile.hpp"
+#include "pm.hpp"
 #include "process.hpp"
+#include "status.hpp"
+#include "utils.hpp"
 
+#ifndef MALI_CLASS_PATH
 #define MALI_CLASS_PATH "/sys/class/misc"
+#endif
+#ifndef MALI_DEVICE_PATH
 #define MALI_DEVICE_PATH "/sys/devices/platform"
+#endif
+
+// Above the timestamp granularity of filesystems, a jiffy
+#define MALI_CTX_TICK_MS 20
 
 using namespace std;
 
+class mali_partition;
+
+// Called with the fields of a partition as soon as they are read by load()
+typedef function<void(mali_partition&, uint32_t)> mali_load_observer;
+
 class mali_partition
 {
     private:
         string partition_name;
-        string status;
-        string slices;
-        string assigned_aw;
+        uint32_t partition_id;
+        uint32_t fields; // declared fields, read on each update
+        uint32_t loaded; // fields read during the current epoch
+        const mali_filter *filter; // NULL if all processes are sampled
+        const mali_load_observer *observer; // NULL if none
+        // Resolved once, slices_path and aw_path on first use
+        string status_path;
+        string slices_path;
+        string aw_path;
+        string gpu_memory_path;
+        string ctx_path;
+        string active_time_path;
+        string suspended_time_path;
+        string devfreq_freq_path; // empty if the device has no devfreq
+        string devfreq_load_path;
+        bool devfreq_resolved;
+        mali_status status;
+        mali_mask slices;
+        mali_mask assigned_aw;
         uint64_t memory_usage; // in kB
+        uint64_t reported_memory_usage; // in kB, as of the last reported change
+        mali_pm_history pm_history;
+        uint64_t frequency; // in Hz, 0 if unknown
+        int devfreq_load;   // in %, -1 if unknown
+        // Sorted by PID; the previous snapshot is kept to report changes
         vector<mali_process> processes;
+        vector<mali_process> previous_processes;
+        // Commands and cgroups of the current and previous snapshots
+        mali_arena arenas[2];
+        unsigned arena;
+        // Sorted PIDs and inodes of the contexts of the current and previous
+        // listings, a process is the same while one of its contexts remains
+        vector<pair<pid_t, uint64_t>> contexts;
+        vector<pair<pid_t, uint64_t>> previous_contexts;
+        // Sorted PIDs and context inodes of processes whose command matched
+        // no glob, their command is read again once they exec'd
+        vector<pair<pid_t, uint64_t>> rejected;
+        vector<pair<pid_t, uint64_t>> previous_rejected;
+        // Contexts are only listed again when dirty or when the ctx
+        // directory changed since it was last listed
+        bool processes_dirty;
+        bool refresh_cmds; // commands and cgroups are read again on next listing
+        vector<pid_t> exec_pids; // same, for these processes only
+        nlink_t ctx_nlink;
+        struct timespec ctx_mtime;
+        bool ctx_racy; // changed too recently to trust its modification time
+        // Per-cgroup totals, maintained incrementally if cgroups are declared
+        mali_cgroup_map cgroups;
+        bool cgroups_valid;
+        // Memory profiles read on demand, for the current epoch only
+        uint64_t epoch;
+        uint64_t mem_profiles_epoch;
+        map<pid_t, mali_mem_profile> mem_profiles;
 
     public:
         // Getter
-        string get_partition_name() { return partition_name; };
-        string get_status() { return status; };
-        string get_slices() { return slices; };
-        string get_assigned_aw() { return assigned_aw; };
-        uint64_t get_memory_usage() { return memory_usage; };
-        vector<mali_process> get_processes() { return processes; };
+        const string& get_partition_name() const { return partition_name; };
+        uint32_t get_partition_id() const { return partition_id; };
+        uint32_t get_fields() const { return fields; };
+        uint32_t get_loaded() const { return loaded; };
+        mali_status get_status() { if (!(loaded & MALI_FIELD_STATUS)) set_status(); return status; };
+        mali_mask get_slices() { if (!(loaded & MALI_FIELD_SLICES)) set_slices(); return slices; };
+        mali_mask get_assigned_aw() { if (!(loaded & MALI_FIELD_ASSIGNED_AW)) set_assigned_aw(); return assigned_aw; };
+        uint64_t get_memory_usage() { if (!(loaded & MALI_FIELD_MEMORY)) set_memory_usage(); return memory_usage; };
+        mali_duty_cycle get_duty_cycle(uint64_t window = MALI_PM_WINDOW_MS) { load(MALI_FIELD_PM_COUNTERS); return pm_history.get_duty_cycle(window); };
+        uint64_t get_frequency() { load(MALI_FIELD_PM_COUNTERS); return frequency; };
+        int get_load() { load(MALI_FIELD_PM_COUNTERS); return devfreq_load; };
+        vector<mali_process>& get_processes(uint32_t f = MALI_FIELD_PROCESS_ALL) { load(f); return processes; };
+        const mali_cgroup_map& get_cgroups() { if (!cgroups_valid) set_cgroups(); return cgroups; };
+        mali_cgroup_usage get_cgroup_usage(const string& prefix) { return mali_cgroup_sum(get_cgroups(), prefix); };
+        const mali_mem_profile& get_mem_profile(pid_t pid);
+        mali_process *find_process(pid_t pid);
+        bool is_rejected(pid_t pid) const;
         // Setter
+        void set_config_paths();
         void set_status();
         void set_slices();
-        int set_slices(string s);
+        int set_slices(mali_mask s);
         void set_assigned_aw();
-        int set_assigned_aw(string aw);
+        int set_assigned_aw(mali_mask aw);
         void set_memory_usage();
+        void set_pm_counters();
         void set_processes();
+        void list_processes();
+        void keep_processes();
+        void filter_processes();
+        void set_process_cmds();
+        void set_process_cgroups();
+        void set_cgroups();
+        void notify(uint32_t& before);
+        void load(uint32_t f);
+        void set_observer(const mali_load_observer *o) { observer = o; };
+        void invalidate_processes() { processes_dirty = true; };
+        void refresh_processes() { processes_dirty = true; refresh_cmds = true; };
+        void refresh_process(pid_t pid) { processes_dirty = true; exec_pids.push_back(pid); };
         // Constructor / Destructor
-        mali_partition(string part);
+        mali_partition(string part, uint32_t f = MALI_FIELD_ALL, const mali_filter *flt = NULL);
+        mali_partition(mali_partition&&) = default;
+        mali_partition& operator=(mali_partition&&) = default;
         ~mali_partition() { processes.clear(); };
         //
-        void update();
+        void update(mali_change_set& changes, uint64_t memory_epsilon = 0);
 };
 
 #endif // _PARTITION_H_
\ No newline at end of file
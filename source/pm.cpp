@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "pm.hpp"
+
+
+/*
+ * Returns true if status s is on the active side of a runtime PM cycle
+ */
+static bool is_active(mali_status s)
+{
+    return s == MALI_STATUS_ACTIVE || s == MALI_STATUS_RESUMING;
+}
+
+/*
+ * Adds sample s, dropping the oldest sample if the history is full
+ */
+void mali_pm_history::add(const mali_pm_sample& s)
+{
+    // Counters restart if the device was removed and probed again
+    if (count > 0 && (s.active_time < latest().active_time || s.suspended_time < latest().suspended_time))
+        count = 0;
+
+    // The latest sample is replaced until it is MALI_PM_MIN_PERIOD_MS newer than
+    // the previous one, counters being cumulative only transitions are lost
+    if (count > 1 && s.valid && latest().valid && latest().timestamp - previous().timestamp < MALI_PM_MIN_PERIOD_MS)
+    {
+        samples[(head + MALI_PM_HISTORY_SIZE - 1) % MALI_PM_HISTORY_SIZE] = s;
+        return;
+    }
+
+    samples[head] = s;
+    head = (head + 1) % MALI_PM_HISTORY_SIZE;
+    if (count < MALI_PM_HISTORY_SIZE)
+        count++;
+}
+
+/*
+ * Returns activity over the last window ms, not valid if the counters did
+ * not advance over the window
+ * With a single sample, activity is computed since the device was probed
+ */
+mali_duty_cycle mali_pm_history::get_duty_cycle(uint64_t window) const
+{
+    mali_duty_cycle d = {};
+    const mali_pm_sample *newest, *oldest, *cur;
+    unsigned n;
+
+    if (count == 0 || !latest().valid)
+        return d;
+
+    newest = &latest();
+    oldest = newest;
+
+    // Walk back to the oldest valid sample within the window
+    for (n = 1; n < count; n++)
+    {
+        const mali_pm_sample *s = &samples[(head + MALI_PM_HISTORY_SIZE - 1 - n) % MALI_PM_HISTORY_SIZE];
+
+        if (!s->valid || newest->timestamp - s->timestamp > window)
+            break;
+
+        // Minimum transitions needed to go from s to the next sample
+        cur = oldest;
+        oldest = s;
+
+        bool was_active = is_active(s->status), now_active = is_active(cur->status);
+        bool ran = cur->active_time > s->active_time, slept = cur->suspended_time > s->suspended_time;
+
+        if (was_active && !now_active)
+            d.suspends++;
+        else if (!was_active && now_active)
+            d.resumes++;
+        else if (was_active && slept)
+        {
+            d.suspends++;
+            d.resumes++;
+        }
+        else if (!was_active && ran)
+        {
+            d.resumes++;
+            d.suspends++;
+        }
+    }
+
+    if (oldest == newest)
+    {
+        d.active_time = newest->active_time;
+        d.suspended_time = newest->suspended_time;
+        d.window = d.active_time + d.suspended_time;
+    }
+    else
+    {
+        d.active_time = newest->active_time - oldest->active_time;
+        d.suspended_time = newest->suspended_time - oldest->suspended_time;
+        d.window = newest->timestamp - oldest->timestamp;
+    }
+
+    // Counters that did not advance tell nothing
+    if (d.active_time + d.suspended_time == 0)
+        return mali_duty_cycle();
+
+    d.valid = true;
+    d.duty_cycle = (double)d.active_time / (double)(d.active_time + d.suspended_time);
+
+    if (d.window > 0)
+    {
+        d.suspend_rate = d.suspends * 1000.0 / d.window;
+        d.resume_rate = d.resumes * 1000.0 / d.window;
+    }
+
+    return d;
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _PM_H_
+#define _PM_H_
+
+#include <cstdint>
+
+#include "status.hpp"
+
+#define MALI_PM_WINDOW_MS 10000
+#define MALI_PM_MIN_PERIOD_MS 100 // as MALI_SAMPLER_MIN_INTERVAL_MS
+// Enough samples at least MALI_PM_MIN_PERIOD_MS apart to span the window
+#define MALI_PM_HISTORY_SIZE (MALI_PM_WINDOW_MS / MALI_PM_MIN_PERIOD_MS + 2)
+
+/*
+ * Runtime PM counters of a partition at a given time
+ * Counters are in ms, as in device/power/runtime_{active,suspended}_time
+ */
+struct mali_pm_sample
+{
+    uint64_t timestamp;      // CLOCK_MONOTONIC in ms
+    uint64_t active_time;
+    uint64_t suspended_time;
+    mali_status status;
+    bool valid;              // false if counters could not be read
+};
+
+/*
+ * Activity of a partition over a window
+ * suspends and resumes are lower bounds: transitions happening between two
+ * samples are only seen through counter deltas
+ */
+struct mali_duty_cycle
+{
+    bool valid;
+    uint64_t window;         // in ms, actually covered by samples
+    uint64_t active_time;    // in ms
+    uint64_t suspended_time; // in ms
+    double duty_cycle;       // active time ratio in [0, 1]
+    uint32_t suspends;
+    uint32_t resumes;
+    double suspend_rate;     // per second
+    double resume_rate;      // per second
+};
+
+/*
+ * Fixed size history of runtime PM samples, spanning MALI_PM_WINDOW_MS
+ * at any sampling rate
+ */
+class mali_pm_history
+{
+    private:
+        mali_pm_sample samples[MALI_PM_HISTORY_SIZE];
+        unsigned head;
+        unsigned count;
+
+    public:
+        // Getter
+        bool empty() const { return count == 0; };
+        const mali_pm_sample& latest() const { return samples[(head + MALI_PM_HISTORY_SIZE - 1) % MALI_PM_HISTORY_SIZE]; };
+        const mali_pm_sample& previous() const { return samples[(head + MALI_PM_HISTORY_SIZE - 2) % MALI_PM_HISTORY_SIZE]; };
+        mali_duty_cycle get_duty_cycle(uint64_t window) const;
+        // Setter
+        void add(const mali_pm_sample& s);
+        // Constructor
+        mali_pm_history() : head(0), count(0) {};
+};
+
+#endif // _PM_H_
@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "procconn.hpp"
+
+#define MALI_PROC_ACK_TIMEOUT_MS 500
+
+
+/*
+ * Sends a proc connector multicast listen (or ignore) request and, when
+ * listening, waits for its acknowledgement
+ * Returns 0 on success
+ */
+int mali_proc_listener::subscribe(bool listen)
+{
+    alignas(8) char buf[MALI_PROC_BUFFER_SIZE];
+    struct nlmsghdr nlh;
+    struct cn_msg msg;
+    enum proc_cn_mcast_op op = listen ? PROC_CN_MCAST_LISTEN : PROC_CN_MCAST_IGNORE;
+    struct pollfd pfd = {fd, POLLIN, 0};
+    uint32_t token = getpid();
+    ssize_t len;
+
+    memset(buf, 0, NLMSG_SPACE(sizeof(msg) + sizeof(op)));
+    memset(&nlh, 0, sizeof(nlh));
+    memset(&msg, 0, sizeof(msg));
+    nlh.nlmsg_len = NLMSG_LENGTH(sizeof(msg) + sizeof(op));
+    nlh.nlmsg_type = NLMSG_DONE;
+    msg.id.idx = CN_IDX_PROC;
+    msg.id.val = CN_VAL_PROC;
+    msg.ack = token;
+    msg.len = sizeof(op);
+    memcpy(buf, &nlh, sizeof(nlh));
+    memcpy(buf + NLMSG_HDRLEN, &msg, sizeof(msg));
+    memcpy(buf + NLMSG_HDRLEN + sizeof(msg), &op, sizeof(op));
+
+    if (send(fd, buf, nlh.nlmsg_len, 0) < 0)
+        return 1;
+    if (!listen)
+        return 0;
+
+    // Without CAP_NET_ADMIN in the initial namespaces, the request is
+    // acknowledged with an error or not at all
+    while (::poll(&pfd, 1, MALI_PROC_ACK_TIMEOUT_MS) > 0)
+    {
+        struct proc_event ev;
+
+        if ((len = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) < 0)
+        {
+            if (errno == EINTR || errno == EAGAIN || errno == ENOBUFS)
+                continue;
+            return 1;
+        }
+        if ((size_t)len < NLMSG_HDRLEN + sizeof(msg) + sizeof(ev))
+            continue;
+
+        memcpy(&msg, buf + NLMSG_HDRLEN, sizeof(msg));
+        memcpy(&ev, buf + NLMSG_HDRLEN + sizeof(msg), sizeof(ev));
+
+        // Acknowledgements echo the ack number of the request plus one
+        if (ev.what == proc_event::PROC_EVENT_NONE && msg.ack == token + 1)
+            return ev.event_data.ack.err != 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Opens a NETLINK_CONNECTOR socket on proc connector events
+ * The listener is not open if the socket cannot be bound or the
+ * subscription is refused, e.g. without CAP_NET_ADMIN
+ */
+mali_proc_listener::mali_proc_listener()
+{
+    struct sockaddr_nl addr;
+
+    owned = true;
+    fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_CONNECTOR);
+
+    if (fd < 0)
+        return;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = CN_IDX_PROC;
+
+    if (bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0 || subscribe(true) != 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+}
+
+/*
+ * Destructor - an injected socket is left open
+ */
+mali_proc_listener::~mali_proc_listener()
+{
+    if (owned && fd >= 0)
+    {
+        subscribe(false);
+        close(fd);
+    }
+}
+
+/*
+ * Records the exec events of datagram msg, other events are ignored
+ */
+void mali_proc_listener::parse(const char *msg, size_t len)
+{
+    struct nlmsghdr nlh;
+    struct cn_msg cn;
+    struct proc_event ev;
+
+    // Fields are copied out, an injected datagram may not be aligned
+    while (len >= NLMSG_HDRLEN)
+    {
+        memcpy(&nlh, msg, sizeof(nlh));
+
+        if (nlh.nlmsg_len < NLMSG_HDRLEN || nlh.nlmsg_len > len)
+            break;
+
+        if (nlh.nlmsg_len >= NLMSG_LENGTH(sizeof(cn) + sizeof(ev)))
+        {
+            memcpy(&cn, msg + NLMSG_HDRLEN, sizeof(cn));
+            memcpy(&ev, msg + NLMSG_HDRLEN + sizeof(cn), sizeof(ev));
+
+            if (cn.id.idx == CN_IDX_PROC && cn.id.val == CN_VAL_PROC && ev.what == proc_event::PROC_EVENT_EXEC)
+                execs.push_back(ev.event_data.exec.process_tgid);
+        }
+
+        if (NLMSG_ALIGN(nlh.nlmsg_len) >= len)
+            break;
+        msg += NLMSG_ALIGN(nlh.nlmsg_len);
+        len -= NLMSG_ALIGN(nlh.nlmsg_len);
+    }
+}
+
+/*
+ * Drains pending events without blocking, replacing those of the
+ * previous poll
+ * Returns true if events were lost and processes must be rescanned
+ */
+bool mali_proc_listener::poll()
+{
+    alignas(8) char buf[MALI_PROC_BUFFER_SIZE];
+    bool lost = false;
+    ssize_t len;
+
+    execs.clear();
+
+    if (fd < 0)
+        return false;
+
+    while (1)
+    {
+        len = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+
+        if (len < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            // The socket buffer overflowed, events were dropped
+            if (errno == ENOBUFS)
+                lost = true;
+            break;
+        }
+        if (len == 0)
+            break;
+
+        parse(buf, len);
+    }
+
+    return lost;
+}
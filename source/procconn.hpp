@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _PROCCONN_H_
+#define _PROCCONN_H_
+
+#include <cstddef>
+#include <vector>
+#include <sys/types.h>
+
+#define MALI_PROC_BUFFER_SIZE 8192
+
+using namespace std;
+
+/*
+ * Listens to process exec events of the kernel proc connector.
+ * The socket can be injected, e.g. one end of a socketpair fed with
+ * connector formatted datagrams, instead of NETLINK_CONNECTOR. Listening
+ * on the proc connector is only allowed from the initial namespaces, and
+ * needs CAP_NET_ADMIN on kernels older than 6.6.
+ */
+class mali_proc_listener
+{
+    private:
+        int fd;
+        bool owned;
+        // Execs drained by the last poll(), storage is kept across polls
+        vector<pid_t> execs;
+
+        int subscribe(bool listen);
+
+    public:
+        // Getter
+        int get_fd() const { return fd; };
+        bool is_open() const { return fd >= 0; };
+        const vector<pid_t>& get_execs() const { return execs; };
+        //
+        void parse(const char *msg, size_t len);
+        bool poll();
+        // Constructor / Destructor
+        mali_proc_listener();
+        explicit mali_proc_listener(int sock) : fd(sock), owned(false) {};
+        mali_proc_listener(const mali_proc_listener&) = delete;
+        ~mali_proc_listener();
+};
+
+#endif // _PROCCONN_H_
@@ -22,56 +22,80 @@
  * SOFTWARE.
  */
 
+#include <cstdio>
+
 #include "process.hpp"
 #include "utils.hpp"
 
 
 /*
  * Get process command from system using PID
+ * Arguments are separated by spaces
  */
-void mali_process::set_cmd()
+void mali_process::set_cmd(mali_arena& arena)
 {
-    cmd = get_file_content(string("/proc/") + pid + string("/cmdline"));
+    char path[32];
+    char buf[MALI_READ_BUFFER_SIZE];
+    ssize_t len;
+
+    snprintf(path, sizeof(path), "/proc/%d/cmdline", pid);
+
+    if ((len = read_file(path, buf, sizeof(buf))) < 0)
+    {
+        cmd = "N/A";
+        return;
+    }
+
+    while (len > 0 && buf[len - 1] == '\0')
+        len--;
+
+    for (ssize_t i = 0; i < len; i++)
+    {
+        if (buf[i] == '\0')
+            buf[i] = ' ';
+    }
+
+    cmd = arena.store(buf, len);
 }
 
 /*
- * Get GPU memory usage from system using PID
+ * Get process cgroup v2 path from system using PID
+ * The path is empty if the process is not in the unified hierarchy
  */
-void mali_process::set_memory_usage()
+void mali_process::set_cgroup(mali_arena& arena)
 {
-    string gpu_mem_f = string(MALI_DBG_PATH) + "/" + partition_name + "/gpu_memory";
-    string gpu_mempages;
-    fstream file_fs;
+    char path[32];
+    const char *line;
+    size_t len;
 
-    file_fs.open(gpu_mem_f, fstream::in);
+    snprintf(path, sizeof(path), "/proc/%d/cgroup", pid);
+    mali_line_reader reader(path);
 
-    if (file_fs.is_open())
+    cgroup = "";
+
+    // cgroup v2 entry is "0::<path>"
+    while (reader.next(line, len))
     {
-        while (getline(file_fs, gpu_mempages))
+        if (len > 3 && line[0] == '0' && line[1] == ':' && line[2] == ':')
         {
-            if (gpu_mempages.find("pid: "+ pid) != string::npos)
-            {
-                gpu_mempages.replace(0, gpu_mempages.find(pid)+ pid.length(), "");
-                break;
-            }
+            cgroup = arena.store(line + 3, len - 3);
+            break;
         }
-
-        if (gpu_mempages != "")
-            memory_usage = stoi(gpu_mempages) * 4; // in kB
-        else
-            memory_usage = -1;
     }
-
-    file_fs.close();
 }
 
 /*
  * Constructor
- */ 
-mali_process::mali_process(string part, string proc_id)
-{ 
-    partition_name = part;
+ * Command, cgroup and memory usage are set by the owning partition
+ * ino is the inode of the process context directory
+ */
+mali_process::mali_process(uint32_t part, pid_t proc_id, uint64_t ino)
+{
+    partition_id = part;
     pid = proc_id;
-    set_cmd();
-    set_memory_usage();
+    ctx_ino = ino;
+    cmd = NULL;
+    cgroup = NULL;
+    memory_usage = -1;
+    reported_memory_usage = -1;
 }
@@ -25,9 +25,15 @@
 #ifndef _PROCESS_H_
 #define _PROCESS_H_
 
+#include <cstdint>
 #include <string>
+#include <sys/types.h>
 
+#include "utils.hpp"
+
+#ifndef MALI_DBG_PATH
 #define MALI_DBG_PATH "/sys/kernel/debug"
+#endif
 
 using namespace std;
 
@@ -35,23 +41,29 @@ using namespace std;
 class mali_process
 {
     private:
-        string partition_name;
-        string pid;
-        string cmd;
+        uint32_t partition_id;
+        pid_t pid;
+        uint64_t ctx_ino; // inode of its first context, identifies the process along with its PID
+        const char *cmd; // stored in the partition snapshot arena, NULL until read
+        const char *cgroup; // cgroup v2 path, same storage as cmd
         int64_t memory_usage; // in kB
+        int64_t reported_memory_usage; // in kB, as of the last reported change
 
     public:
         // Getter
-        string get_pid() { return pid; };
-        string get_partition_name() { return partition_name; };
-        string get_cmd() { return cmd; };
-        int64_t get_memory_usage() { return memory_usage; };
+        pid_t get_pid() const { return pid; };
+        uint32_t get_partition_id() const { return partition_id; };
+        const char *get_cmd() const { return cmd != NULL ? cmd : ""; };
+        const char *get_cgroup() const { return cgroup != NULL ? cgroup : ""; };
+        int64_t get_memory_usage() const { return memory_usage; };
         // Setter - from system config
-        void set_cmd(); 
-        void set_memory_usage();
+        void set_cmd(mali_arena& arena);
+        void set_cgroup(mali_arena& arena);
         // Constructor / Destructor
-        mali_process(string part, string proc_id);
+        mali_process(uint32_t part, pid_t proc_id, uint64_t ino = 0);
         ~mali_process() {};
+
+    friend class mali_partition;
 };
 
 #endif // _PROCESS_H_
\ No newline at end of file
@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "procindex.hpp"
+
+
+/*
+ * Returns the entry of pid in partition_id, NULL if there is none
+ */
+mali_index_entry *mali_process_index::find(pid_t pid, uint32_t partition_id)
+{
+    unordered_map<pid_t, vector<mali_index_entry>>::iterator it = pids.find(pid);
+
+    if (it == pids.end())
+        return NULL;
+
+    for (mali_index_entry& i : it->second)
+    {
+        if (i.partition_id == partition_id)
+            return &i;
+    }
+
+    return NULL;
+}
+
+/*
+ * Returns the entries of pid, one per partition it uses, NULL if none
+ */
+const vector<mali_index_entry> *mali_process_index::find_pid(pid_t pid) const
+{
+    unordered_map<pid_t, vector<mali_index_entry>>::const_iterator it = pids.find(pid);
+
+    return it != pids.end() ? &it->second : NULL;
+}
+
+/*
+ * Returns the entries whose command line is cmd
+ * Entries are valid until the index changes
+ */
+vector<const mali_index_entry *> mali_process_index::find_cmd(const string& cmd) const
+{
+    vector<const mali_index_entry *> out;
+    pair<unordered_multimap<string, pair<pid_t, uint32_t>>::const_iterator,
+         unordered_multimap<string, pair<pid_t, uint32_t>>::const_iterator> range = cmds.equal_range(cmd);
+
+    for (unordered_multimap<string, pair<pid_t, uint32_t>>::const_iterator it = range.first; it != range.second; it++)
+    {
+        for (const mali_index_entry& i : pids.at(it->second.first))
+        {
+            if (i.partition_id == it->second.second)
+                out.push_back(&i);
+        }
+    }
+
+    return out;
+}
+
+/*
+ * Returns the n entries using the most memory, in decreasing order
+ * Entries are valid until the index changes
+ */
+vector<const mali_index_entry *> mali_process_index::get_top(size_t n) const
+{
+    vector<const mali_index_entry *> out;
+
+    for (set<mali_index_rank>::const_iterator it = ranks.begin(); it != ranks.end() && out.size() < n; it++)
+    {
+        for (const mali_index_entry& i : pids.at(it->pid))
+        {
+            if (i.partition_id == it->partition_id)
+                out.push_back(&i);
+        }
+    }
+
+    return out;
+}
+
+/*
+ * Adds pid to partition_id, replacing any previous entry
+ */
+void mali_process_index::add(pid_t pid, uint32_t partition_id, int64_t memory_usage, const char *cmd)
+{
+    mali_index_rank r = {memory_usage, pid, partition_id};
+
+    remove(pid, partition_id);
+
+    pids[pid].push_back({pid, partition_id, memory_usage, cmd});
+    cmds.insert(make_pair(string(cmd), make_pair(pid, partition_id)));
+    ranks.insert(r);
+}
+
+/*
+ * Removes pid from partition_id
+ */
+void mali_process_index::remove(pid_t pid, uint32_t partition_id)
+{
+    unordered_map<pid_t, vector<mali_index_entry>>::iterator it = pids.find(pid);
+    pair<unordered_multimap<string, pair<pid_t, uint32_t>>::iterator,
+         unordered_multimap<string, pair<pid_t, uint32_t>>::iterator> range;
+
+    if (it == pids.end())
+        return;
+
+    for (mali_index_entry& e : it->second)
+    {
+        if (e.partition_id != partition_id)
+            continue;
+
+        range = cmds.equal_range(e.cmd);
+        for (unordered_multimap<string, pair<pid_t, uint32_t>>::iterator c = range.first; c != range.second; c++)
+        {
+            if (c->second == make_pair(pid, partition_id))
+            {
+                cmds.erase(c);
+                break;
+            }
+        }
+
+        ranks.erase({e.memory_usage, pid, partition_id});
+
+        e = it->second.back();
+        it->second.pop_back();
+        break;
+    }
+
+    if (it->second.empty())
+        pids.erase(it);
+}
+
+/*
+ * Removes all processes of partition_id
+ */
+void mali_process_index::remove_partition(uint32_t partition_id)
+{
+    vector<pid_t> gone;
+
+    for (const mali_index_rank& i : ranks)
+    {
+        if (i.partition_id == partition_id)
+            gone.push_back(i.pid);
+    }
+
+    for (pid_t i : gone)
+        remove(i, partition_id);
+}
+
+/*
+ * Moves pid of partition_id to its new memory usage
+ */
+void mali_process_index::set_memory_usage(pid_t pid, uint32_t partition_id, int64_t memory_usage)
+{
+    mali_index_entry *e = find(pid, partition_id);
+
+    if (e == NULL || e->memory_usage == memory_usage)
+        return;
+
+    ranks.erase({e->memory_usage, pid, partition_id});
+    ranks.insert({memory_usage, pid, partition_id});
+    e->memory_usage = memory_usage;
+}
+
+/*
+ * Removes all processes
+ */
+void mali_process_index::clear()
+{
+    pids.clear();
+    cmds.clear();
+    ranks.clear();
+}
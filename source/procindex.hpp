@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _PROCINDEX_H_
+#define _PROCINDEX_H_
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <sys/types.h>
+
+using namespace std;
+
+/*
+ * A process as seen by one partition
+ */
+struct mali_index_entry
+{
+    pid_t pid;
+    uint32_t partition_id;
+    int64_t memory_usage; // in kB, -1 if unknown
+    string cmd;
+};
+
+/*
+ * Key of an entry in the memory order: by decreasing memory usage, then
+ * by PID and partition
+ */
+struct mali_index_rank
+{
+    int64_t memory_usage;
+    pid_t pid;
+    uint32_t partition_id;
+
+    bool operator<(const mali_index_rank& o) const
+    {
+        if (memory_usage != o.memory_usage)
+            return memory_usage > o.memory_usage;
+        return pid < o.pid || (pid == o.pid && partition_id < o.partition_id);
+    };
+};
+
+/*
+ * Processes of all partitions, indexed by PID, by command line and by
+ * memory usage. Entries are added, moved and removed one by one, so the
+ * index can follow the changes of each update.
+ */
+class mali_process_index
+{
+    private:
+        unordered_map<pid_t, vector<mali_index_entry>> pids;
+        unordered_multimap<string, pair<pid_t, uint32_t>> cmds;
+        set<mali_index_rank> ranks;
+
+        mali_index_entry *find(pid_t pid, uint32_t partition_id);
+
+    public:
+        // Getter
+        size_t size() const { return ranks.size(); };
+        const vector<mali_index_entry> *find_pid(pid_t pid) const;
+        vector<const mali_index_entry *> find_cmd(const string& cmd) const;
+        vector<const mali_index_entry *> get_top(size_t n) const;
+        // Setter
+        void add(pid_t pid, uint32_t partition_id, int64_t memory_usage, const char *cmd);
+        void remove(pid_t pid, uint32_t partition_id);
+        void remove_partition(uint32_t partition_id);
+        void set_memory_usage(pid_t pid, uint32_t partition_id, int64_t memory_usage);
+        void clear();
+};
+
+#endif // _PROCINDEX_H_
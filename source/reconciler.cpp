@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <ctime>
+#include <fstream>
+#include <sstream>
+
+#include "reconciler.hpp"
+#include "utils.hpp"
+
+
+/*
+ * Returns CLOCK_MONOTONIC in ms
+ */
+static uint64_t now_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * Loads the desired layout from file, one partition per line:
+ *   <partition> <slices> <access window>
+ * e.g. "mali0 0x3 0x1". "-" leaves a field unmanaged, "#" starts a comment.
+ * Returns 0 on success
+ */
+int mali_reconciler::load(const string& file)
+{
+    ifstream file_fs(file);
+    string line;
+    int line_no = 0;
+
+    if (!file_fs.is_open())
+    {
+        cout << "Failed to open " << file << endl;
+        return 1;
+    }
+
+    desired.clear();
+
+    while (getline(file_fs, line))
+    {
+        istringstream tokens(line.substr(0, line.find('#')));
+        string name, s, aw, extra;
+        mali_desired_partition d;
+
+        line_no++;
+
+        if (!(tokens >> name))
+            continue;
+
+        if (!(tokens >> s >> aw) || (tokens >> extra))
+        {
+            cout << file << ":" << line_no << ": expected <partition> <slices> <access window>" << endl;
+            return 1;
+        }
+
+        d.partition_name = name;
+        d.slices = s == "-" ? mali_mask() : mali_mask::parse(s, true);
+        d.assigned_aw = aw == "-" ? mali_mask() : mali_mask::parse(aw, true);
+        d.slices_backoff = mali_field_backoff();
+        d.aw_backoff = mali_field_backoff();
+        d.missing = false;
+
+        if ((s != "-" && !d.slices.is_valid()) || (aw != "-" && !d.assigned_aw.is_valid()))
+        {
+            cout << file << ":" << line_no << ": invalid hex value (e.g. 0xF)" << endl;
+            return 1;
+        }
+
+        for (mali_desired_partition& i : desired)
+        {
+            if (i.partition_name == d.partition_name)
+            {
+                cout << file << ":" << line_no << ": partition " << name << " already defined" << endl;
+                return 1;
+            }
+            if (i.slices.is_valid() && d.slices.is_valid() && i.slices.overlaps(d.slices))
+            {
+                cout << file << ":" << line_no << ": slices of " << name << " overlap with " << i.partition_name << endl;
+                return 1;
+            }
+            if (i.assigned_aw.is_valid() && d.assigned_aw.is_valid() && i.assigned_aw.overlaps(d.assigned_aw))
+            {
+                cout << file << ":" << line_no << ": access windows of " << name << " overlap with " << i.partition_name << endl;
+                return 1;
+            }
+        }
+
+        desired.push_back(d);
+    }
+
+    return 0;
+}
+
+/*
+ * Records a drift event, and logs it if a log is set
+ */
+void mali_reconciler::add_event(mali_desired_partition& d, const char *field, mali_mask actual, mali_mask wanted,
+                                mali_drift_action action)
+{
+    mali_drift_event e = { now_ms(), d.partition_name, field, actual, wanted, action };
+
+    if (events.size() == MALI_RECONCILER_EVENTS)
+        events.erase(events.begin());
+    events.push_back(e);
+
+    if (log != NULL)
+        *log << e << endl;
+}
+
+/*
+ * Writes the desired slices (or access window) of partition p if they
+ * drifted, then reads them back
+ * Returns true if a write was issued
+ */
+bool mali_reconciler::reconcile_field(mali_desired_partition& d, mali_partition& p, bool slices, uint64_t now)
+{
+    const char *field = slices ? "slices" : "assigned_aw";
+    mali_mask wanted = slices ? d.slices : d.assigned_aw;
+    mali_mask actual = slices ? p.get_slices() : p.get_assigned_aw();
+    mali_field_backoff& b = slices ? d.slices_backoff : d.aw_backoff;
+    mali_mask read_back;
+
+    if (!wanted.is_valid() || actual == wanted)
+        return false;
+
+    // Drift while backing off is only logged when first seen or when it changes
+    if (now < b.next_attempt)
+    {
+        if (!b.logged || b.logged_actual != actual)
+            add_event(d, field, actual, wanted, MALI_DRIFT_BACKOFF);
+        b.logged = true;
+        b.logged_actual = actual;
+        return false;
+    }
+
+    b.logged = false;
+
+    if (slices)
+    {
+        p.set_slices(wanted);
+        p.set_slices();
+        read_back = p.get_slices();
+    }
+    else
+    {
+        p.set_assigned_aw(wanted);
+        p.set_assigned_aw();
+        read_back = p.get_assigned_aw();
+    }
+
+    if (read_back == wanted)
+    {
+        add_event(d, field, actual, wanted, MALI_DRIFT_WRITTEN);
+        b.failures = 0;
+        b.next_attempt = 0;
+    }
+    else
+    {
+        // Exponential backoff, so a rejected layout is not rewritten every tick
+        uint64_t backoff = MALI_RECONCILER_BACKOFF_MS << (b.failures < 6 ? b.failures : 6);
+
+        add_event(d, field, actual, wanted, MALI_DRIFT_FAILED);
+        b.failures++;
+        b.next_attempt = now + (backoff < MALI_RECONCILER_MAX_BACKOFF_MS ? backoff : MALI_RECONCILER_MAX_BACKOFF_MS);
+    }
+
+    return true;
+}
+
+/*
+ * Compares the current layout of gpu, as read during its current epoch,
+ * with the desired layout and writes partitions that drifted
+ * Partitions giving slices or access windows away are written first, so
+ * they are free when other partitions take them
+ * Returns the number of writes issued
+ */
+int mali_reconciler::reconcile(mali_gpu& gpu)
+{
+    uint64_t now = now_ms();
+    int writes = 0;
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (mali_desired_partition& d : desired)
+        {
+            mali_partition *p = NULL;
+
+            for (mali_partition& i : gpu.get_partitions())
+            {
+                if (i.get_partition_name() == d.partition_name)
+                    p = &i;
+            }
+
+            if (p == NULL)
+            {
+                if (pass == 0 && !d.missing)
+                    add_event(d, "partition", mali_mask(), mali_mask(), MALI_DRIFT_MISSING);
+                d.missing = true;
+                continue;
+            }
+            d.missing = false;
+
+            // Shrinking fields on the first pass, others on the second
+            for (int slices = 1; slices >= 0; slices--)
+            {
+                mali_mask wanted = slices ? d.slices : d.assigned_aw;
+                mali_mask actual = slices ? p->get_slices() : p->get_assigned_aw();
+                bool shrinking = !wanted.is_valid() || (wanted.get_bits() & ~actual.get_bits()) == 0;
+
+                if (shrinking == (pass == 0))
+                    writes += reconcile_field(d, *p, slices, now);
+            }
+        }
+    }
+
+    return writes;
+}
+
+/*
+ * Print drift event
+ */
+ostream& operator<<(ostream& os, const mali_drift_event& e)
+{
+    static const char *actions[] = { "corrected", "write failed", "backing off", "missing" };
+
+    os << "[" << e.timestamp << "] " << e.partition_name << " " << e.field << ": " << actions[e.action];
+    if (e.action != MALI_DRIFT_MISSING)
+        os << " (actual " << e.actual.to_string() << ", desired " << e.desired.to_string() << ")";
+
+    return os;
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _RECONCILER_H_
+#define _RECONCILER_H_
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gpu.hpp"
+#include "mask.hpp"
+
+#define MALI_RECONCILER_BACKOFF_MS 1000
+#define MALI_RECONCILER_MAX_BACKOFF_MS 60000
+#define MALI_RECONCILER_EVENTS 256
+
+using namespace std;
+
+/*
+ * Write attempts of a managed field
+ */
+struct mali_field_backoff
+{
+    unsigned failures;     // consecutive writes that did not take effect
+    uint64_t next_attempt; // CLOCK_MONOTONIC in ms
+    bool logged;           // drift while backing off already logged
+    mali_mask logged_actual;
+};
+
+/*
+ * Desired layout of a partition, an invalid mask means the field is not
+ * managed
+ */
+struct mali_desired_partition
+{
+    string partition_name;
+    mali_mask slices;
+    mali_mask assigned_aw;
+    mali_field_backoff slices_backoff;
+    mali_field_backoff aw_backoff;
+    bool missing;          // missing partition already logged
+};
+
+enum mali_drift_action
+{
+    MALI_DRIFT_WRITTEN,    // drift corrected
+    MALI_DRIFT_FAILED,     // write did not take effect, backing off
+    MALI_DRIFT_BACKOFF,    // drift seen while backing off, not written
+    MALI_DRIFT_MISSING,    // partition not found
+};
+
+struct mali_drift_event
+{
+    uint64_t timestamp;    // CLOCK_MONOTONIC in ms
+    string partition_name;
+    const char *field;     // "slices" or "assigned_aw"
+    mali_mask actual;      // value that drifted
+    mali_mask desired;
+    mali_drift_action action;
+};
+
+/*
+ * Brings partitions to a desired layout, only writing those that drifted
+ */
+class mali_reconciler
+{
+    private:
+        vector<mali_desired_partition> desired;
+        vector<mali_drift_event> events; // last MALI_RECONCILER_EVENTS events
+        ostream *log;
+
+        void add_event(mali_desired_partition& d, const char *field, mali_mask actual, mali_mask wanted,
+                       mali_drift_action action);
+        bool reconcile_field(mali_desired_partition& d, mali_partition& p, bool slices, uint64_t now);
+
+    public:
+        // Getter
+        const vector<mali_desired_partition>& get_desired() const { return desired; };
+        const vector<mali_drift_event>& get_events() const { return events; };
+        // Setter
+        int load(const string& file);
+        void set_log(ostream *os) { log = os; };
+        //
+        int reconcile(mali_gpu& gpu);
+        // Constructor
+        mali_reconciler() : log(NULL) {};
+};
+
+ostream& operator<<(ostream& os, const mali_drift_event& e);
+
+#endif // _RECONCILER_H_
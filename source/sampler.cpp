@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cerrno>
+#include <ctime>
+#include <poll.h>
+
+#include "sampler.hpp"
+
+
+/*
+ * Returns the time of clock in ns
+ */
+static uint64_t clock_ns(clockid_t clock)
+{
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * Exponentially weighted moving average, a zero average takes the sample
+ */
+static uint64_t ewma(uint64_t avg, uint64_t sample)
+{
+    return avg ? (3 * avg + sample) / 4 : sample;
+}
+
+/*
+ * Constructor, b is the CPU time budget as a fraction of one core
+ */
+mali_sampler::mali_sampler(double b)
+{
+    budget = b > 0 ? b : MALI_SAMPLER_BUDGET;
+    interval = MALI_SAMPLER_INTERVAL_MS;
+    activity = MALI_SAMPLER_INTERVAL_MS;
+    refresh_cost = 0;
+    cycle_cost = 0;
+    cycle_time = 0;
+    last_cpu = 0;
+    last_wall = 0;
+}
+
+/*
+ * Updates gpu, measuring its cost, and adapts the interval until the next
+ * update. The cost of a cycle includes whatever the caller did since the
+ * previous update (e.g. rendering), as it is spent because of sampling too
+ */
+const mali_change_set& mali_sampler::update(mali_gpu& gpu)
+{
+    uint64_t cpu = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+    uint64_t wall = clock_ns(CLOCK_MONOTONIC);
+    const mali_change_set& changes = gpu.update();
+    uint64_t end = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+    uint64_t floor;
+
+    refresh_cost = ewma(refresh_cost, end - cpu);
+
+    if (last_wall != 0)
+    {
+        cycle_cost = ewma(cycle_cost, end - last_cpu);
+        cycle_time = ewma(cycle_time, wall - last_wall);
+    }
+    else
+        cycle_cost = refresh_cost;
+
+    last_cpu = end;
+    last_wall = wall;
+
+    // Sample faster right after a change, then back off by 1.5x per quiet update
+    if (!changes.empty())
+        activity = MALI_SAMPLER_MIN_INTERVAL_MS;
+    else
+        activity = activity * 3 / 2 < MALI_SAMPLER_MAX_INTERVAL_MS ? activity * 3 / 2 : MALI_SAMPLER_MAX_INTERVAL_MS;
+
+    // The budget wins over activity: a cycle costing c needs at least c / budget
+    floor = (uint64_t)(cycle_cost / budget / 1000000);
+    interval = activity > floor ? activity : floor;
+
+    return changes;
+}
+
+/*
+ * Sleeps until the next update is due or, if fd is set, until it is
+ * readable (e.g. process events) once the shortest interval the budget
+ * allows has elapsed
+ */
+void mali_sampler::wait(int fd) const
+{
+    uint64_t earliest = (uint64_t)(cycle_cost / budget / 1000000);
+    struct pollfd pfd = {fd, POLLIN, 0};
+    struct timespec ts;
+
+    if (earliest < MALI_SAMPLER_MIN_INTERVAL_MS)
+        earliest = MALI_SAMPLER_MIN_INTERVAL_MS;
+    if (fd < 0 || earliest > interval)
+        earliest = interval;
+
+    ts = { (time_t)(earliest / 1000), (long)(earliest % 1000) * 1000000 };
+
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+        ;
+
+    if (earliest < interval)
+        while (::poll(&pfd, 1, interval - earliest) < 0 && errno == EINTR)
+            ;
+}
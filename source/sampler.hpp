@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _SAMPLER_H_
+#define _SAMPLER_H_
+
+#include <cstdint>
+
+#include "gpu.hpp"
+
+#define MALI_SAMPLER_BUDGET 0.005          // fraction of one core
+#define MALI_SAMPLER_INTERVAL_MS 1000
+#define MALI_SAMPLER_MIN_INTERVAL_MS 100
+#define MALI_SAMPLER_MAX_INTERVAL_MS 10000
+
+using namespace std;
+
+/*
+ * Adapts the sampling interval of a mali_gpu to hold a CPU time budget:
+ * sampling is faster around changes, backs off in steady state, and never
+ * costs more than the budget
+ */
+class mali_sampler
+{
+    private:
+        double budget;
+        uint64_t interval;       // in ms
+        uint64_t activity;       // interval wanted from changes alone, in ms
+        uint64_t refresh_cost;   // average thread CPU time of update(), in ns
+        uint64_t cycle_cost;     // average thread CPU time between updates, in ns
+        uint64_t cycle_time;     // average wall time between updates, in ns
+        uint64_t last_cpu;
+        uint64_t last_wall;
+
+    public:
+        // Getter
+        double get_budget() const { return budget; };
+        uint64_t get_interval() const { return interval; };
+        uint64_t get_refresh_cost() const { return refresh_cost; };
+        double get_rate() const { return cycle_time ? 1e9 / cycle_time : 1000.0 / interval; };
+        double get_overhead() const { return cycle_time ? (double)cycle_cost / cycle_time : 0; };
+        //
+        const mali_change_set& update(mali_gpu& gpu);
+        void wait(int fd = -1) const;
+        // Constructor
+        mali_sampler(double b = MALI_SAMPLER_BUDGET);
+};
+
+#endif // _SAMPLER_H_
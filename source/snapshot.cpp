@@ -0,0 +1,329 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstddef>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include "snapshot.hpp"
+#include "utils.hpp"
+
+
+/*
+ * Copies string s into the fixed size field dst, truncating if needed
+ */
+static void copy_field(char *dst, size_t len, const char *s)
+{
+    size_t n = strnlen(s, len - 1);
+
+    memcpy(dst, s, n);
+    memset(dst + n, 0, len - n);
+}
+
+/*
+ * Opens and maps the shared memory segment name in write mode
+ */
+mali_snapshot_writer::mali_snapshot_writer(string name)
+{
+    int fd;
+    void *addr;
+
+    shm_name = name;
+    region = NULL;
+
+    if ((fd = shm_open(shm_name.c_str(), O_CREAT | O_RDWR, 0644)) < 0)
+    {
+        cout << "Failed to open shared memory " << shm_name << endl;
+        return;
+    }
+
+    if (ftruncate(fd, sizeof(mali_snapshot_region)) != 0)
+    {
+        cout << "Failed to resize shared memory " << shm_name << endl;
+        close(fd);
+        return;
+    }
+
+    addr = mmap(NULL, sizeof(mali_snapshot_region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (addr == MAP_FAILED)
+    {
+        cout << "Failed to map shared memory " << shm_name << endl;
+        return;
+    }
+
+    region = static_cast<mali_snapshot_region *>(addr);
+
+    // Mark the segment as being written until the first publication,
+    // the sequence keeps increasing if the segment already existed
+    region->sequence.store(region->sequence.load(memory_order_relaxed) | 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memset(&region->data, 0, sizeof(region->data));
+    region->magic = MALI_SNAPSHOT_MAGIC;
+    region->version = MALI_SNAPSHOT_VERSION;
+    region->size = sizeof(mali_snapshot_region);
+}
+
+/*
+ * Destructor - the segment is kept so readers can still access the last
+ * published snapshot, its timestamp tells how old it is
+ */
+mali_snapshot_writer::~mali_snapshot_writer()
+{
+    if (region != NULL)
+        munmap(region, sizeof(mali_snapshot_region));
+}
+
+/*
+ * Fills d with the current state of gpu, and the rate and overhead of
+ * sampler if any
+ */
+void mali_snapshot_fill(mali_snapshot_data *d, mali_gpu& gpu, const mali_sampler *sampler)
+{
+    struct timespec ts;
+    uint32_t part_count = 0, proc_count = 0;
+    uint32_t fields = gpu.get_fields();
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    // Only declared fields are published, so publishing issues no extra I/O
+    d->timestamp = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    copy_field(d->name, sizeof(d->name), fields & MALI_FIELD_NAME ? gpu.get_name().c_str() : "N/A");
+    copy_field(d->ddk_version, sizeof(d->ddk_version), fields & MALI_FIELD_DDK_VERSION ? gpu.get_ddk_version().c_str() : "N/A");
+    d->system_memory = fields & MALI_FIELD_SYSTEM_MEMORY ? gpu.get_system_memory() : 0;
+    d->memory_usage = fields & MALI_FIELD_MEMORY ? gpu.get_memory_usage() : 0;
+    d->flags = 0;
+    d->sample_interval = sampler ? sampler->get_interval() : 0;
+    d->overhead = sampler ? (uint32_t)(sampler->get_overhead() * 1000000) : 0;
+
+    for (mali_partition& p : gpu.get_partitions())
+    {
+        mali_snapshot_partition *sp;
+        mali_mask slices, aw;
+
+        if (part_count == MALI_SNAPSHOT_MAX_PARTITIONS)
+        {
+            d->flags |= MALI_SNAPSHOT_TRUNCATED_PARTITIONS;
+            break;
+        }
+
+        sp = &d->partitions[part_count];
+        copy_field(sp->partition_name, sizeof(sp->partition_name), p.get_partition_name().c_str());
+        copy_field(sp->status, sizeof(sp->status),
+                   mali_status_name(fields & MALI_FIELD_STATUS ? p.get_status() : MALI_STATUS_UNKNOWN));
+        slices = fields & MALI_FIELD_SLICES ? p.get_slices() : mali_mask();
+        aw = fields & MALI_FIELD_ASSIGNED_AW ? p.get_assigned_aw() : mali_mask();
+        sp->slices = slices.get_bits();
+        sp->assigned_aw = aw.get_bits();
+        sp->memory_usage = fields & MALI_FIELD_MEMORY ? p.get_memory_usage() : 0;
+        sp->process_count = 0;
+        sp->flags = (slices.is_valid() ? MALI_SNAPSHOT_HAS_SLICES : 0) | (aw.is_valid() ? MALI_SNAPSHOT_HAS_AW : 0);
+
+        if (!(fields & MALI_FIELD_PROCESS_ALL))
+        {
+            part_count++;
+            continue;
+        }
+
+        for (mali_process& proc : p.get_processes(fields))
+        {
+            mali_snapshot_process *spr;
+
+            sp->process_count++;
+
+            if (proc_count == MALI_SNAPSHOT_MAX_PROCESSES)
+            {
+                d->flags |= MALI_SNAPSHOT_TRUNCATED_PROCESSES;
+                continue;
+            }
+
+            spr = &d->processes[proc_count++];
+            spr->partition = part_count;
+            spr->pid = proc.get_pid();
+            spr->memory_usage = proc.get_memory_usage();
+            copy_field(spr->cmd, sizeof(spr->cmd), proc.get_cmd());
+        }
+
+        part_count++;
+    }
+
+    d->partition_count = part_count;
+    d->process_count = proc_count;
+}
+
+/*
+ * Publishes current state of gpu, and the rate and overhead of sampler if any
+ */
+void mali_snapshot_writer::publish(mali_gpu& gpu, const mali_sampler *sampler)
+{
+    uint64_t seq;
+
+    if (region == NULL)
+        return;
+
+    // Odd sequence: readers retry until the write is complete
+    seq = region->sequence.load(memory_order_relaxed) | 1;
+    region->sequence.store(seq, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    mali_snapshot_fill(&region->data, gpu, sampler);
+
+    region->sequence.store(seq + 1, memory_order_release);
+}
+
+/*
+ * Opens and maps the shared memory segment name in read only mode
+ */
+mali_snapshot_reader::mali_snapshot_reader(string name)
+{
+    int fd;
+    struct stat statbuf;
+    void *addr;
+    const mali_snapshot_region *r;
+
+    region = NULL;
+
+    if ((fd = shm_open(name.c_str(), O_RDONLY, 0)) < 0)
+        return;
+
+    if (fstat(fd, &statbuf) != 0 || (size_t)statbuf.st_size < sizeof(mali_snapshot_region))
+    {
+        close(fd);
+        return;
+    }
+
+    addr = mmap(NULL, sizeof(mali_snapshot_region), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (addr == MAP_FAILED)
+        return;
+
+    r = static_cast<const mali_snapshot_region *>(addr);
+
+    // Only accept segments with the expected layout
+    if (r->magic != MALI_SNAPSHOT_MAGIC || r->version != MALI_SNAPSHOT_VERSION
+        || r->size != sizeof(mali_snapshot_region))
+    {
+        munmap(addr, sizeof(mali_snapshot_region));
+        return;
+    }
+
+    region = r;
+}
+
+/*
+ * Destructor
+ */
+mali_snapshot_reader::~mali_snapshot_reader()
+{
+    if (region != NULL)
+        munmap((void *)region, sizeof(mali_snapshot_region));
+}
+
+/*
+ * Copies a consistent snapshot into out
+ * Returns false if no consistent snapshot could be read
+ */
+bool mali_snapshot_reader::read(mali_snapshot_data& out) const
+{
+    const mali_snapshot_data *d;
+
+    if (region == NULL)
+        return false;
+
+    d = &region->data;
+
+    for (int i = 0; i < MALI_SNAPSHOT_RETRIES; i++)
+    {
+        uint64_t seq = region->sequence.load(memory_order_acquire);
+        uint32_t part_count, proc_count;
+
+        if (seq & 1)
+            continue;
+
+        // Only copy used entries, counts are bounded in case of a torn read
+        memcpy(&out, d, offsetof(mali_snapshot_data, partitions));
+        part_count = out.partition_count < MALI_SNAPSHOT_MAX_PARTITIONS ? out.partition_count : MALI_SNAPSHOT_MAX_PARTITIONS;
+        proc_count = out.process_count < MALI_SNAPSHOT_MAX_PROCESSES ? out.process_count : MALI_SNAPSHOT_MAX_PROCESSES;
+        memcpy(out.partitions, d->partitions, part_count * sizeof(mali_snapshot_partition));
+        memcpy(out.processes, d->processes, proc_count * sizeof(mali_snapshot_process));
+
+        atomic_thread_fence(memory_order_acquire);
+
+        if (region->sequence.load(memory_order_relaxed) == seq)
+            return true;
+    }
+
+    return false;
+}
+
+/*
+ * Copies a consistent snapshot of partition name into out, and optionally
+ * the total system memory published along with it
+ * Returns false if the partition is unknown or no consistent snapshot could be read
+ */
+bool mali_snapshot_reader::read_partition(const string& name, mali_snapshot_partition& out, uint64_t *system_memory) const
+{
+    const mali_snapshot_data *d;
+
+    if (region == NULL || name.length() >= MALI_SNAPSHOT_FIELD_LEN)
+        return false;
+
+    d = &region->data;
+
+    for (int i = 0; i < MALI_SNAPSHOT_RETRIES; i++)
+    {
+        uint64_t seq = region->sequence.load(memory_order_acquire);
+        uint32_t part_count;
+        bool found = false;
+
+        if (seq & 1)
+            continue;
+
+        part_count = d->partition_count < MALI_SNAPSHOT_MAX_PARTITIONS ? d->partition_count : MALI_SNAPSHOT_MAX_PARTITIONS;
+
+        for (uint32_t j = 0; j < part_count; j++)
+        {
+            if (strncmp(d->partitions[j].partition_name, name.c_str(), MALI_SNAPSHOT_FIELD_LEN) == 0)
+            {
+                memcpy(&out, &d->partitions[j], sizeof(mali_snapshot_partition));
+                found = true;
+                break;
+            }
+        }
+
+        if (system_memory != NULL)
+            *system_memory = d->system_memory;
+
+        atomic_thread_fence(memory_order_acquire);
+
+        if (region->sequence.load(memory_order_relaxed) == seq)
+            return found;
+    }
+
+    return false;
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "gpu.hpp"
+#include "sampler.hpp"
+
+#define MALI_SNAPSHOT_MAGIC 0x4d474d53 // "SMGM"
+#define MALI_SNAPSHOT_VERSION 3
+#define MALI_SNAPSHOT_MAX_PARTITIONS 16
+#define MALI_SNAPSHOT_MAX_PROCESSES 256
+#define MALI_SNAPSHOT_NAME_LEN 64
+#define MALI_SNAPSHOT_FIELD_LEN 24
+#define MALI_SNAPSHOT_CMD_LEN 128
+#define MALI_SNAPSHOT_RETRIES 1000
+
+#define MALI_SNAPSHOT_TRUNCATED_PARTITIONS 0x1
+#define MALI_SNAPSHOT_TRUNCATED_PROCESSES  0x2
+
+#define MALI_SNAPSHOT_HAS_SLICES 0x1
+#define MALI_SNAPSHOT_HAS_AW     0x2
+
+using namespace std;
+
+/*
+ * Fixed layout of the shared memory segment. All strings are NUL terminated
+ * and truncated to fit. The layout only changes along with
+ * MALI_SNAPSHOT_VERSION.
+ */
+struct mali_snapshot_process
+{
+    uint32_t partition;   // index in mali_snapshot_data::partitions
+    int32_t pid;
+    int64_t memory_usage; // in kB, -1 if unknown
+    char cmd[MALI_SNAPSHOT_CMD_LEN];
+};
+
+struct mali_snapshot_partition
+{
+    char partition_name[MALI_SNAPSHOT_FIELD_LEN];
+    char status[MALI_SNAPSHOT_FIELD_LEN];
+    uint64_t slices;       // bitmask of slice IDs
+    uint64_t assigned_aw;  // bitmask of access window IDs
+    uint64_t memory_usage; // in kB
+    uint32_t process_count;
+    uint32_t flags;        // MALI_SNAPSHOT_HAS_*
+};
+
+struct mali_snapshot_data
+{
+    uint64_t timestamp;     // CLOCK_MONOTONIC in ns at publication
+    char name[MALI_SNAPSHOT_NAME_LEN];
+    char ddk_version[MALI_SNAPSHOT_NAME_LEN];
+    uint64_t system_memory; // in kB
+    uint64_t memory_usage;  // in kB
+    uint32_t flags;         // MALI_SNAPSHOT_TRUNCATED_*
+    uint32_t partition_count;
+    uint32_t process_count;
+    uint32_t sample_interval; // in ms, 0 if not sampling
+    uint32_t overhead;        // sampling CPU time in ppm of one core
+    uint32_t reserved;
+    mali_snapshot_partition partitions[MALI_SNAPSHOT_MAX_PARTITIONS];
+    mali_snapshot_process processes[MALI_SNAPSHOT_MAX_PROCESSES];
+};
+
+struct mali_snapshot_region
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t size;
+    atomic<uint64_t> sequence; // odd while the writer is updating data
+    mali_snapshot_data data;
+};
+
+void mali_snapshot_fill(mali_snapshot_data *d, mali_gpu& gpu, const mali_sampler *sampler = NULL);
+
+/*
+ * Publishes mali_gpu state into a POSIX shared memory segment
+ */
+class mali_snapshot_writer
+{
+    private:
+        string shm_name;
+        mali_snapshot_region *region;
+
+    public:
+        bool is_open() { return region != NULL; };
+        void publish(mali_gpu& gpu, const mali_sampler *sampler = NULL);
+        // Constructor / Destructor
+        mali_snapshot_writer(string name);
+        ~mali_snapshot_writer();
+};
+
+/*
+ * Reads consistent snapshots from a POSIX shared memory segment
+ * without any syscall nor lock once mapped
+ */
+class mali_snapshot_reader
+{
+    private:
+        const mali_snapshot_region *region;
+
+    public:
+        bool is_open() { return region != NULL; };
+        bool read(mali_snapshot_data& out) const;
+        bool read_partition(const string& name, mali_snapshot_partition& out, uint64_t *system_memory = NULL) const;
+        // Constructor / Destructor
+        mali_snapshot_reader(string name);
+        ~mali_snapshot_reader();
+};
+
+#endif // _SNAPSHOT_H_
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstring>
+
+#include "status.hpp"
+
+
+static const char *status_names[MALI_STATUS_COUNT] =
+{
+    "N/A",
+    "active",
+    "resuming",
+    "suspending",
+    "suspended",
+    "error",
+    "unsupported",
+};
+
+/*
+ * Returns the printable name of status
+ */
+const char *mali_status_name(mali_status status)
+{
+    if (status >= MALI_STATUS_COUNT)
+        status = MALI_STATUS_UNKNOWN;
+
+    return status_names[status];
+}
+
+/*
+ * Parses status s, trailing white spaces are ignored
+ * Returns MALI_STATUS_UNKNOWN if s is not a known status
+ */
+mali_status mali_status_parse(const char *s, size_t len)
+{
+    while (len > 0 && (s[len - 1] == '\n' || s[len - 1] == ' '))
+        len--;
+
+    for (int i = MALI_STATUS_ACTIVE; i < MALI_STATUS_COUNT; i++)
+    {
+        if (strlen(status_names[i]) == len && strncmp(s, status_names[i], len) == 0)
+            return static_cast<mali_status>(i);
+    }
+
+    return MALI_STATUS_UNKNOWN;
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _STATUS_H_
+#define _STATUS_H_
+
+#include <cstddef>
+
+/*
+ * Runtime PM status of a partition, as in device/power/runtime_status
+ */
+enum mali_status
+{
+    MALI_STATUS_UNKNOWN,
+    MALI_STATUS_ACTIVE,
+    MALI_STATUS_RESUMING,
+    MALI_STATUS_SUSPENDING,
+    MALI_STATUS_SUSPENDED,
+    MALI_STATUS_ERROR,
+    MALI_STATUS_UNSUPPORTED,
+    MALI_STATUS_COUNT
+};
+
+const char *mali_status_name(mali_status status);
+
+mali_status mali_status_parse(const char *s, size_t len);
+
+#endif // _STATUS_H_
@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+
+#include "trace.hpp"
+
+
+/*
+ * Returns CLOCK_MONOTONIC in us
+ */
+static uint64_t now_us()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*
+ * Writes s as a JSON string
+ */
+void mali_trace_writer::write_string(const char *s)
+{
+    out << '"';
+
+    for (; *s != '\0'; s++)
+    {
+        unsigned char c = *s;
+
+        if (c == '"' || c == '\\')
+            out << '\\' << c;
+        else if (c < 0x20)
+        {
+            char esc[8];
+
+            snprintf(esc, sizeof(esc), "\\u%04x", c);
+            out << esc;
+        }
+        else
+            out << c;
+    }
+
+    out << '"';
+}
+
+/*
+ * Opens an event of phase ph on track tid, arguments may follow before
+ * end_event()
+ */
+void mali_trace_writer::begin_event(const char *name, const char *ph, uint64_t ts, uint32_t tid)
+{
+    out << (first ? "" : ",\n") << "{\"name\":";
+    write_string(name);
+    out << ",\"ph\":\"" << ph << "\",\"ts\":" << ts << ",\"pid\":" << MALI_TRACE_PID << ",\"tid\":" << tid;
+    first = false;
+}
+
+void mali_trace_writer::end_event()
+{
+    out << "}";
+}
+
+/*
+ * Begins or ends the status slice of partition p
+ */
+void mali_trace_writer::write_status(mali_partition& p, uint64_t ts, bool begin)
+{
+    begin_event(mali_status_name(p.get_status()), begin ? "B" : "E", ts, p.get_partition_id() + 1);
+    end_event();
+}
+
+/*
+ * Writes the memory counter of partition p
+ */
+void mali_trace_writer::write_memory(mali_partition& p, uint64_t ts)
+{
+    char name[64];
+
+    snprintf(name, sizeof(name), "%s memory (kB)", p.get_partition_name().c_str());
+    begin_event(name, "C", ts, p.get_partition_id() + 1);
+    out << ",\"args\":{\"kB\":" << p.get_memory_usage() << "}";
+    end_event();
+}
+
+/*
+ * Writes the memory counter of process pid, unknown memory reads as 0
+ */
+void mali_trace_writer::write_process_memory(uint32_t partition_id, pid_t pid, int64_t memory, uint64_t ts)
+{
+    char name[64];
+
+    snprintf(name, sizeof(name), "mali%u PID %d memory (kB)", partition_id, pid);
+    begin_event(name, "C", ts, partition_id + 1);
+    out << ",\"args\":{\"kB\":" << (memory < 0 ? 0 : memory) << "}";
+    end_event();
+}
+
+/*
+ * Writes the sampling rate and overhead counters, on the GPU track
+ */
+void mali_trace_writer::write_sampler(const mali_sampler& sampler, uint64_t ts)
+{
+    begin_event("sampling rate (Hz)", "C", ts, 0);
+    out << ",\"args\":{\"Hz\":" << sampler.get_rate() << "}";
+    end_event();
+    begin_event("sampling overhead (% of one core)", "C", ts, 0);
+    out << ",\"args\":{\"%\":" << sampler.get_overhead() * 100 << "}";
+    end_event();
+}
+
+/*
+ * Opens file and writes the current state of g
+ * Declared fields of g are traced, record() must be called after each
+ * update of g
+ */
+mali_trace_writer::mali_trace_writer(const string& file, mali_gpu& g) : out(file), gpu(g), first(true)
+{
+    uint32_t fields = gpu.get_fields();
+    uint64_t ts = now_us();
+
+    if (!out.is_open())
+    {
+        cout << "Failed to open " << file << endl;
+        return;
+    }
+
+    out << "[\n";
+
+    begin_event("process_name", "M", 0, 0);
+    out << ",\"args\":{\"name\":";
+    write_string(fields & MALI_FIELD_NAME ? gpu.get_name().c_str() : "Mali GPU");
+    out << "}";
+    end_event();
+
+    for (mali_partition& p : gpu.get_partitions())
+    {
+        begin_event("thread_name", "M", 0, p.get_partition_id() + 1);
+        out << ",\"args\":{\"name\":";
+        write_string(p.get_partition_name().c_str());
+        out << "}";
+        end_event();
+
+        if (fields & MALI_FIELD_STATUS)
+            write_status(p, ts, true);
+        if (fields & MALI_FIELD_MEMORY)
+            write_memory(p, ts);
+        if (fields & MALI_FIELD_PROCESS_MEMORY)
+        {
+            for (mali_process& i : p.get_processes(fields))
+                write_process_memory(p.get_partition_id(), i.get_pid(), i.get_memory_usage(), ts);
+        }
+    }
+
+    out << flush;
+}
+
+/*
+ * Closes open status slices and the JSON array. A capture that is not
+ * closed (e.g. killed) still loads, the trailing "]" is optional.
+ */
+mali_trace_writer::~mali_trace_writer()
+{
+    if (!out.is_open())
+        return;
+
+    if (gpu.get_fields() & MALI_FIELD_STATUS)
+    {
+        uint64_t ts = now_us();
+
+        for (mali_partition& p : gpu.get_partitions())
+            write_status(p, ts, false);
+    }
+
+    out << "\n]\n";
+}
+
+/*
+ * Writes the changes of the last update of gpu and, if set, the state of
+ * the sampler that drives it
+ */
+void mali_trace_writer::record(const mali_sampler *sampler)
+{
+    uint64_t ts = now_us();
+
+    if (!out.is_open())
+        return;
+
+    for (const mali_change& c : gpu.get_changes())
+    {
+        mali_partition *p = gpu.find_partition(c.partition_id);
+        uint32_t tid = c.partition_id + 1;
+        char old_mask[24], new_mask[24];
+
+        switch (c.kind)
+        {
+            case MALI_CHANGE_STATUS:
+                begin_event(mali_status_name(c.old_status), "E", ts, tid);
+                end_event();
+                begin_event(mali_status_name(c.new_status), "B", ts, tid);
+                end_event();
+                break;
+
+            case MALI_CHANGE_SLICES:
+            case MALI_CHANGE_ASSIGNED_AW:
+                if (!c.old_mask.format(old_mask, sizeof(old_mask)))
+                    snprintf(old_mask, sizeof(old_mask), "N/A");
+                if (!c.new_mask.format(new_mask, sizeof(new_mask)))
+                    snprintf(new_mask, sizeof(new_mask), "N/A");
+                begin_event(c.kind == MALI_CHANGE_SLICES ? "slices changed" : "access window changed", "i", ts, tid);
+                out << ",\"s\":\"t\",\"args\":{\"old\":\"" << old_mask << "\",\"new\":\"" << new_mask << "\"}";
+                end_event();
+                break;
+
+            case MALI_CHANGE_PARTITION_MEMORY:
+                if (p != NULL)
+                    write_memory(*p, ts);
+                break;
+
+            case MALI_CHANGE_PROCESS_ARRIVED:
+            case MALI_CHANGE_PROCESS_EXITED:
+                begin_event(c.kind == MALI_CHANGE_PROCESS_ARRIVED ? "process arrived" : "process exited", "i", ts, tid);
+                out << ",\"s\":\"t\",\"args\":{\"pid\":" << c.pid;
+                if (c.kind == MALI_CHANGE_PROCESS_ARRIVED && p != NULL)
+                {
+                    // Processes are sorted by PID
+                    vector<mali_process>& procs = p->get_processes(gpu.get_fields());
+                    vector<mali_process>::iterator it = lower_bound(procs.begin(), procs.end(), c.pid,
+                        [](const mali_process& a, pid_t pid) { return a.get_pid() < pid; });
+
+                    if (it != procs.end() && it->get_pid() == c.pid && it->get_cmd()[0] != '\0')
+                    {
+                        out << ",\"cmd\":";
+                        write_string(it->get_cmd());
+                    }
+                }
+                out << "}";
+                end_event();
+                if (gpu.get_fields() & MALI_FIELD_PROCESS_MEMORY)
+                    write_process_memory(c.partition_id, c.pid,
+                                         c.kind == MALI_CHANGE_PROCESS_ARRIVED ? c.new_memory : 0, ts);
+                break;
+
+            case MALI_CHANGE_PROCESS_MEMORY:
+                write_process_memory(c.partition_id, c.pid, c.new_memory, ts);
+                break;
+
+            case MALI_CHANGE_PARTITION_ADDED:
+                begin_event("thread_name", "M", 0, tid);
+                out << ",\"args\":{\"name\":\"mali" << c.partition_id << "\"}";
+                end_event();
+                if (p != NULL && (gpu.get_fields() & MALI_FIELD_STATUS))
+                    write_status(*p, ts, true);
+                break;
+
+            case MALI_CHANGE_PARTITION_REMOVED:
+                if (gpu.get_fields() & MALI_FIELD_STATUS)
+                {
+                    begin_event("removed", "E", ts, tid);
+                    end_event();
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    if (sampler != NULL)
+        write_sampler(*sampler, ts);
+
+    // Keep the capture usable if the process is killed
+    out << flush;
+}
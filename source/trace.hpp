@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include "gpu.hpp"
+#include "sampler.hpp"
+
+// Trace process ID of the GPU, away from real PIDs of CPU traces
+#define MALI_TRACE_PID 0x7fff0000
+
+using namespace std;
+
+/*
+ * Streams the state of a mali_gpu as Chrome trace event JSON, which opens
+ * in ui.perfetto.dev and chrome://tracing along with CPU traces:
+ * - partition status as slices, one track per partition,
+ * - partition and process memory as counters,
+ * - slices and access window reconfigurations as instant events,
+ * - process arrivals and exits as instant events,
+ * - sampling rate and overhead as counters, when sampled periodically.
+ * Events are written as they happen, memory use does not grow with the
+ * capture. Timestamps are CLOCK_MONOTONIC, as in Linux CPU traces.
+ */
+class mali_trace_writer
+{
+    private:
+        ofstream out;
+        mali_gpu& gpu;
+        bool first; // no event written yet
+
+        void begin_event(const char *name, const char *ph, uint64_t ts, uint32_t tid);
+        void end_event();
+        void write_string(const char *s);
+        void write_status(mali_partition& p, uint64_t ts, bool begin);
+        void write_memory(mali_partition& p, uint64_t ts);
+        void write_process_memory(uint32_t partition_id, pid_t pid, int64_t memory, uint64_t ts);
+        void write_sampler(const mali_sampler& sampler, uint64_t ts);
+
+    public:
+        bool is_open() const { return out.is_open(); };
+        void record(const mali_sampler *sampler = NULL);
+        // Constructor / Destructor
+        mali_trace_writer(const string& file, mali_gpu& g);
+        ~mali_trace_writer();
+};
+
+#endif // _TRACE_H_
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "uevent.hpp"
+
+
+/*
+ * Opens a NETLINK_KOBJECT_UEVENT socket on kernel events
+ * The listener is not open if the socket cannot be bound
+ */
+mali_uevent_listener::mali_uevent_listener()
+{
+    struct sockaddr_nl addr;
+
+    owned = true;
+    fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+
+    if (fd < 0)
+        return;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = 1; // kernel events, not udev ones
+
+    if (bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+}
+
+/*
+ * Destructor - an injected socket is left open
+ */
+mali_uevent_listener::~mali_uevent_listener()
+{
+    if (owned && fd >= 0)
+        close(fd);
+}
+
+/*
+ * Returns true if uevent msg adds or removes a Mali misc device
+ * A uevent is "<action>@<devpath>" followed by NUL separated KEY=value
+ */
+bool mali_uevent_listener::is_mali_event(const char *msg, size_t len)
+{
+    const char *end = msg + len;
+    const char *action = NULL, *subsystem = NULL, *devpath = NULL;
+
+    for (const char *p = msg; p < end; p += strnlen(p, end - p) + 1)
+    {
+        if (strncmp(p, "ACTION=", 7) == 0)
+            action = p + 7;
+        else if (strncmp(p, "SUBSYSTEM=", 10) == 0)
+            subsystem = p + 10;
+        else if (strncmp(p, "DEVPATH=", 8) == 0)
+            devpath = p + 8;
+    }
+
+    if (action == NULL || subsystem == NULL || devpath == NULL || strcmp(subsystem, "misc") != 0)
+        return false;
+    if (strcmp(action, "add") != 0 && strcmp(action, "remove") != 0)
+        return false;
+
+    // Same rule as mali_gpu::set_partitions() on the device name
+    return strstr(strrchr(devpath, '/') ? strrchr(devpath, '/') + 1 : devpath, "mali") != NULL;
+}
+
+/*
+ * Drains pending uevents without blocking
+ * Returns true if a Mali device was added or removed, or if events were
+ * lost and the topology must be checked
+ */
+bool mali_uevent_listener::poll()
+{
+    char buf[MALI_UEVENT_BUFFER_SIZE];
+    bool changed = false;
+    ssize_t len;
+
+    if (fd < 0)
+        return false;
+
+    while (1)
+    {
+        // With MSG_TRUNC the full length of the datagram is returned
+        len = recv(fd, buf, sizeof(buf) - 1, MSG_DONTWAIT | MSG_TRUNC);
+
+        if (len < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            // The socket buffer overflowed, events were dropped
+            if (errno == ENOBUFS)
+                changed = true;
+            break;
+        }
+        if (len == 0)
+            break;
+
+        // Keys past the buffer were cut, the event may be a Mali one
+        if ((size_t)len >= sizeof(buf) - 1)
+        {
+            changed = true;
+            continue;
+        }
+
+        buf[len] = '\0';
+        if (is_mali_event(buf, len))
+            changed = true;
+    }
+
+    return changed;
+}
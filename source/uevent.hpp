@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _UEVENT_H_
+#define _UEVENT_H_
+
+#include <cstddef>
+
+#define MALI_UEVENT_BUFFER_SIZE 8192
+
+using namespace std;
+
+/*
+ * Listens to kernel uevents for Mali devices of the misc class being added
+ * or removed. The socket can be injected, e.g. one end of a socketpair fed
+ * with uevent formatted datagrams, instead of NETLINK_KOBJECT_UEVENT.
+ */
+class mali_uevent_listener
+{
+    private:
+        int fd;
+        bool owned;
+
+    public:
+        // Getter
+        int get_fd() const { return fd; };
+        bool is_open() const { return fd >= 0; };
+        //
+        static bool is_mali_event(const char *msg, size_t len);
+        bool poll();
+        // Constructor / Destructor
+        mali_uevent_listener();
+        explicit mali_uevent_listener(int sock) : fd(sock), owned(false) {};
+        mali_uevent_listener(const mali_uevent_listener&) = delete;
+        ~mali_uevent_listener();
+};
+
+#endif // _UEVENT_H_
@@ -22,6 +22,10 @@
  * SOFTWARE.
  */
 
+#include <cstring>
+#include <fcntl.h>
+#include <sys/syscall.h>
+
 #include "utils.hpp"
 
 
@@ -152,3 +156,186 @@ string find_file(string p, string f)
 
     return fp;
 }
+
+/*
+ * Reads at most len - 1 bytes of file fp into buf and NUL terminates it
+ * Returns the number of bytes read, -1 if the file could not be read
+ */
+ssize_t read_file(const char *fp, char *buf, size_t len)
+{
+    int fd;
+    ssize_t n, total = 0;
+
+    if ((fd = open(fp, O_RDONLY | O_CLOEXEC)) < 0)
+        return -1;
+
+    while ((size_t)total < len - 1 && (n = read(fd, buf + total, len - 1 - total)) > 0)
+        total += n;
+
+    close(fd);
+    buf[total] = '\0';
+
+    return total;
+}
+
+/*
+ * Parses the decimal number at p, skipping leading white spaces
+ * p is moved after the number; returns false if there is no number
+ */
+bool parse_number(const char *&p, const char *end, uint64_t &v)
+{
+    const char *start;
+
+    while (p < end && (*p == ' ' || *p == '\t'))
+        p++;
+
+    start = p;
+    v = 0;
+
+    while (p < end && isdigit(*p))
+        v = v * 10 + (*p++ - '0');
+
+    return p != start;
+}
+
+/*
+ * Opens directory path
+ */
+mali_dir::mali_dir(const char *path)
+{
+    fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    pos = 0;
+    len = 0;
+    ino = 0;
+}
+
+/*
+ * Destructor
+ */
+mali_dir::~mali_dir()
+{
+    if (fd >= 0)
+        close(fd);
+}
+
+/*
+ * Returns the name of the next directory entry, NULL at the end
+ * The name is valid until the next call, get_ino() returns its inode
+ */
+const char *mali_dir::next()
+{
+    struct dirent64 *ent;
+
+    if (fd < 0)
+        return NULL;
+
+    if (pos >= len)
+    {
+        len = syscall(SYS_getdents64, fd, buf, sizeof(buf));
+        pos = 0;
+
+        if (len <= 0)
+            return NULL;
+    }
+
+    ent = reinterpret_cast<struct dirent64 *>(buf + pos);
+    pos += ent->d_reclen;
+    ino = ent->d_ino;
+
+    return ent->d_name;
+}
+
+/*
+ * Opens file path
+ */
+mali_line_reader::mali_line_reader(const char *path)
+{
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    start = 0;
+    end = 0;
+    eof = false;
+}
+
+/*
+ * Destructor
+ */
+mali_line_reader::~mali_line_reader()
+{
+    if (fd >= 0)
+        close(fd);
+}
+
+/*
+ * Sets line and len to the next line, without its end of line character
+ * The line is valid until the next call; returns false at the end of file
+ */
+bool mali_line_reader::next(const char *&line, size_t &len)
+{
+    if (fd < 0)
+        return false;
+
+    while (1)
+    {
+        char *nl = static_cast<char *>(memchr(buf + start, '\n', end - start));
+
+        if (nl != NULL)
+        {
+            line = buf + start;
+            len = nl - line;
+            start = nl - buf + 1;
+            return true;
+        }
+
+        // Last line without end of line, or line longer than the buffer
+        if ((eof || (start == 0 && end == sizeof(buf))) && end > start)
+        {
+            line = buf + start;
+            len = end - start;
+            start = end;
+            return true;
+        }
+
+        if (eof)
+            return false;
+
+        // Keep the incomplete line and refill the buffer
+        memmove(buf, buf + start, end - start);
+        end -= start;
+        start = 0;
+
+        ssize_t n = read(fd, buf + end, sizeof(buf) - end);
+
+        if (n <= 0)
+            eof = true;
+        else
+            end += n;
+    }
+}
+
+/*
+ * Copies s into the arena and NUL terminates it, truncating to the block size
+ * Returns the stored string, valid until the next reset
+ */
+const char *mali_arena::store(const char *s, size_t len)
+{
+    char *dst;
+
+    if (len > MALI_ARENA_BLOCK_SIZE - 1)
+        len = MALI_ARENA_BLOCK_SIZE - 1;
+
+    if (block < blocks.size() && offset + len + 1 > MALI_ARENA_BLOCK_SIZE)
+    {
+        block++;
+        offset = 0;
+    }
+
+    if (block == blocks.size())
+        blocks.push_back(unique_ptr<char[]>(new char[MALI_ARENA_BLOCK_SIZE]));
+
+    dst = blocks[block].get() + offset;
+    memcpy(dst, s, len);
+    dst[len] = '\0';
+    offset += len + 1;
+
+    return dst;
+}
@@ -30,11 +30,77 @@
 #include <dirent.h>
 #include <unistd.h>
 #include <fstream>
+#include <memory>
+#include <vector>
 #include <sys/types.h>
 #include <sys/stat.h>
 
+#define MALI_READ_BUFFER_SIZE 4096
+#define MALI_ARENA_BLOCK_SIZE 16384
+
 using namespace std;
 
+/*
+ * Lists the entries of a directory without any heap allocation
+ */
+class mali_dir
+{
+    private:
+        int fd;
+        long pos;
+        long len;
+        uint64_t ino;
+        alignas(8) char buf[MALI_READ_BUFFER_SIZE];
+
+    public:
+        bool is_open() const { return fd >= 0; };
+        uint64_t get_ino() const { return ino; };
+        const char *next();
+        // Constructor / Destructor
+        mali_dir(const char *path);
+        ~mali_dir();
+};
+
+/*
+ * Reads a file line by line through a fixed size buffer, without any heap
+ * allocation. Lines longer than the buffer are split.
+ */
+class mali_line_reader
+{
+    private:
+        int fd;
+        size_t start;
+        size_t end;
+        bool eof;
+        char buf[MALI_READ_BUFFER_SIZE];
+
+    public:
+        bool is_open() const { return fd >= 0; };
+        bool next(const char *&line, size_t &len);
+        // Constructor / Destructor
+        mali_line_reader(const char *path);
+        ~mali_line_reader();
+};
+
+/*
+ * Stores strings for the lifetime of a snapshot. Blocks are kept across
+ * resets so a steady-state snapshot does not allocate, and never move so
+ * stored strings stay valid until the next reset.
+ */
+class mali_arena
+{
+    private:
+        vector<unique_ptr<char[]>> blocks;
+        size_t block;
+        size_t offset;
+
+    public:
+        const char *store(const char *s, size_t len);
+        void reset() { block = 0; offset = 0; };
+        // Constructor
+        mali_arena() : block(0), offset(0) {};
+};
+
 bool is_number(const string &s);
 
 string get_file_content(string fp);
@@ -47,4 +113,8 @@ bool is_file(const string path);
 
 string find_file(string p, string f);
 
+ssize_t read_file(const char *fp, char *buf, size_t len);
+
+bool parse_number(const char *&p, const char *end, uint64_t &v);
+
 #endif // _UTILS_H_
\ No newline at end of file
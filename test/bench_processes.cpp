@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <sys/socket.h>
+
+#include "fake_tree.hpp"
+#include "gpu.hpp"
+#include "procconn.hpp"
+
+#define CONTEXTS 1000
+#define EXECS 100         // exec'd and exiting processes per update
+#define MAX_EXECS 500     // events of an update must fit in the socket buffer
+#define UPDATES 100
+#define LATE_PERIOD 10    // updates between processes opening the GPU
+#define CHURN_PID 1000000 // PIDs of processes that never open the GPU
+#define LATE_PID 2000000  // PIDs of processes that open the GPU without exec'ing
+
+/*
+ * Returns the thread CPU time in ns
+ */
+static uint64_t cpu_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * Appends a proc connector event of process pid to datagram buf, sending
+ * buf on sock first if the listener could not receive it whole
+ */
+static void add_event(int sock, vector<char>& buf, enum proc_event::what what, pid_t pid)
+{
+    struct nlmsghdr nlh;
+    struct cn_msg cn;
+    struct proc_event ev;
+    size_t off;
+
+    if (buf.size() + NLMSG_ALIGN(NLMSG_LENGTH(sizeof(cn) + sizeof(ev))) > MALI_PROC_BUFFER_SIZE)
+    {
+        CHECK(send(sock, buf.data(), buf.size(), 0) == (ssize_t)buf.size());
+        buf.clear();
+    }
+    off = buf.size();
+
+    memset(&nlh, 0, sizeof(nlh));
+    memset(&cn, 0, sizeof(cn));
+    memset(&ev, 0, sizeof(ev));
+    nlh.nlmsg_len = NLMSG_LENGTH(sizeof(cn) + sizeof(ev));
+    nlh.nlmsg_type = NLMSG_DONE;
+    cn.id.idx = CN_IDX_PROC;
+    cn.id.val = CN_VAL_PROC;
+    cn.len = sizeof(ev);
+    ev.what = what;
+    if (what == proc_event::PROC_EVENT_EXEC)
+        ev.event_data.exec.process_pid = ev.event_data.exec.process_tgid = pid;
+    else
+        ev.event_data.exit.process_pid = ev.event_data.exit.process_tgid = pid;
+
+    buf.resize(off + NLMSG_ALIGN(nlh.nlmsg_len));
+    memcpy(&buf[off], &nlh, sizeof(nlh));
+    memcpy(&buf[off + NLMSG_HDRLEN], &cn, sizeof(cn));
+    memcpy(&buf[off + NLMSG_HDRLEN + sizeof(cn)], &ev, sizeof(ev));
+}
+
+/*
+ * Feeds sock the events of execs processes exec'ing then exiting and, if
+ * set, of listed process pid exec'ing
+ */
+static void churn(int sock, unsigned execs, unsigned update, pid_t pid)
+{
+    vector<char> buf;
+
+    for (unsigned i = 0; i < execs; i++)
+    {
+        add_event(sock, buf, proc_event::PROC_EVENT_EXEC, CHURN_PID + update * execs + i);
+        add_event(sock, buf, proc_event::PROC_EVENT_EXIT, CHURN_PID + update * execs + i);
+    }
+    if (pid != 0)
+        add_event(sock, buf, proc_event::PROC_EVENT_EXEC, pid);
+    if (!buf.empty())
+        CHECK(send(sock, buf.data(), buf.size(), 0) == (ssize_t)buf.size());
+}
+
+enum mode
+{
+    LISTING,   // contexts listed on each update
+    STAT,      // contexts listed when the ctx directory changed
+    CONNECTOR, // same, plus exec events under churn
+};
+
+/*
+ * Runs updates in mode m and returns the average CPU time of an update in
+ * ns. Every LATE_PERIOD updates, a process opens the GPU without exec'ing:
+ * it must be found by the update that follows, and be gone once it closed
+ * it. With the connector, a listed process also exec's every LATE_PERIOD
+ * updates.
+ */
+static uint64_t run(unsigned contexts, unsigned execs, unsigned updates, mode m)
+{
+    string ctx = string(MALI_DBG_PATH) + "/mali0/ctx/";
+    struct timespec tick = {0, MALI_CTX_TICK_MS * 1000000};
+    uint64_t total = 0, start;
+    int sv[2];
+
+    fake_create(1);
+    for (unsigned i = 0; i < contexts; i++)
+        fake_add_context(0, 1 + i, i);
+
+    CHECK(socketpair(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0, sv) == 0);
+
+    mali_gpu gpu(MALI_FIELD_PROCESSES);
+
+    if (m == CONNECTOR)
+        CHECK(gpu.watch_processes(sv[1]) == 0);
+    gpu.update();
+    CHECK(gpu.get_partitions()[0].get_processes().size() == contexts);
+
+    for (unsigned u = 0; u < updates; u++)
+    {
+        pid_t late = LATE_PID + u / LATE_PERIOD;
+        bool opened = u % LATE_PERIOD < LATE_PERIOD / 2;
+
+        if (u % LATE_PERIOD == 0)
+            fake_add_context(0, late, 0);
+        else if (u % LATE_PERIOD == LATE_PERIOD / 2)
+            CHECK(rmdir((ctx + to_string(late) + "_0").c_str()) == 0);
+        // Updates are further apart than a timestamp tick in practice, a change just made is listed again
+        if (u % (LATE_PERIOD / 2) == 0)
+            nanosleep(&tick, NULL);
+        // Without a listener, nothing reads the events
+        if (m == CONNECTOR)
+            churn(sv[0], execs, u, u % LATE_PERIOD == LATE_PERIOD - 1 ? 1 + u / LATE_PERIOD % contexts : 0);
+        else if (m == LISTING)
+            gpu.get_partitions()[0].invalidate_processes();
+
+        start = cpu_ns();
+        gpu.update();
+        total += cpu_ns() - start;
+
+        CHECK(gpu.get_partitions()[0].get_processes().size() == contexts + opened);
+        CHECK((gpu.get_partitions()[0].find_process(late) != NULL) == opened);
+    }
+
+    close(sv[0]);
+    close(sv[1]);
+
+    return updates ? total / updates : 0;
+}
+
+/*
+ * Usage: bench_processes [contexts] [execs per update] [updates]
+ */
+int main(int argc, char *argv[])
+{
+    unsigned contexts = argc > 1 ? strtoul(argv[1], NULL, 10) : CONTEXTS;
+    unsigned execs = argc > 2 ? strtoul(argv[2], NULL, 10) : EXECS;
+    unsigned updates = argc > 3 ? strtoul(argv[3], NULL, 10) : UPDATES;
+    uint64_t listing, stat, connector;
+
+    CHECK(contexts > 0 && execs <= MAX_EXECS);
+
+    listing = run(contexts, execs, updates, LISTING);
+    stat = run(contexts, execs, updates, STAT);
+    connector = run(contexts, execs, updates, CONNECTOR);
+
+    cout << contexts << " contexts, " << execs << " execs per update, " << updates << " updates" << endl;
+    cout << "  listing on each update: " << listing / 1000 << " us per update" << endl;
+    cout << "  ctx directory stat: " << stat / 1000 << " us per update" << endl;
+    cout << "  stat and connector: " << connector / 1000 << " us per update, connector "
+         << ((int64_t)connector - (int64_t)stat) / 1000 << " us" << endl;
+
+    return EXIT_SUCCESS;
+}
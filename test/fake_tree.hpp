@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _FAKE_TREE_H_
+#define _FAKE_TREE_H_
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+#define CHECK(cond) \
+    do \
+    { \
+        if (!(cond)) \
+        { \
+            cout << __FILE__ << ":" << __LINE__ << ": check failed: " << #cond << endl; \
+            exit(EXIT_FAILURE); \
+        } \
+    } while (0)
+
+/*
+ * Synthetic sysfs/debugfs tree below MALI_TEST_ROOT, as read by the
+ * library built for tests
+ */
+
+inline int fake_unlink(const char *path, const struct stat *, int, struct FTW *)
+{
+    return remove(path);
+}
+
+/*
+ * Creates directory path and its parents
+ */
+inline void fake_mkdir(const string& path)
+{
+    for (size_t i = path.find('/', 1); i != string::npos; i = path.find('/', i + 1))
+        mkdir(path.substr(0, i).c_str(), 0755);
+    mkdir(path.c_str(), 0755);
+}
+
+/*
+ * Writes content to file path, creating its directory
+ */
+inline void fake_write(const string& path, const string& content)
+{
+    fake_mkdir(path.substr(0, path.rfind('/')));
+    ofstream(path) << content;
+}
+
+/*
+ * Adds a context of pid to partition part
+ */
+inline void fake_add_context(unsigned part, pid_t pid, unsigned tid)
+{
+    fake_mkdir(string(MALI_DBG_PATH) + "/mali" + to_string(part) + "/ctx/" + to_string(pid) + "_" + to_string(tid));
+}
+
+/*
+ * Sets the GPU memory of partition part, in pages, and of its processes
+ */
+inline void fake_gpu_memory(unsigned part, uint64_t pages, const vector<pair<pid_t, uint64_t>>& procs)
+{
+    string s = "mali" + to_string(part) + " " + to_string(pages) + "\n";
+
+    for (const pair<pid_t, uint64_t>& i : procs)
+        s += "  kctx-0x0 pid: " + to_string(i.first) + " " + to_string(i.second) + "\n";
+
+    fake_write(string(MALI_DBG_PATH) + "/mali" + to_string(part) + "/gpu_memory", s);
+}
+
+/*
+ * Sets the runtime PM counters of partition part, in ms
+ */
+inline void fake_pm_counters(unsigned part, uint64_t active, uint64_t suspended)
+{
+    string power = string(MALI_CLASS_PATH) + "/mali" + to_string(part) + "/device/power/";
+
+    fake_write(power + "runtime_active_time", to_string(active) + "\n");
+    fake_write(power + "runtime_suspended_time", to_string(suspended) + "\n");
+}
+
+/*
+ * Creates a GPU with partitions active partitions, each with one slice
+ * and no context
+ */
+inline void fake_create(unsigned partitions)
+{
+    nftw(MALI_TEST_ROOT, fake_unlink, 16, FTW_DEPTH | FTW_PHYS);
+
+    fake_write(string(MALI_GPU_PATH) + "/gpu/gpuinfo", "Mali-G78AE 8 cores r0p0 0xB402\n");
+    fake_write(MALI_DDK_VERSION, "r48p0\n");
+
+    for (unsigned i = 0; i < partitions; i++)
+    {
+        string part = string(MALI_DEVICE_PATH) + "/gpu/partitions/partition" + to_string(i);
+
+        fake_write(string(MALI_CLASS_PATH) + "/mali" + to_string(i) + "/device/power/runtime_status", "active\n");
+        fake_pm_counters(i, 0, 0);
+        fake_write(part + "/active_slices", "0x" + to_string(1 << i) + "\n");
+        fake_write(part + "/assigned_access_windows", "0x" + to_string(1 << i) + "\n");
+        fake_mkdir(string(MALI_DBG_PATH) + "/mali" + to_string(i) + "/ctx");
+        fake_gpu_memory(i, 0, {});
+    }
+}
+
+#endif // _FAKE_TREE_H_
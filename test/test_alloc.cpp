@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstdlib>
+#include <new>
+#include <sys/socket.h>
+
+#include "fake_tree.hpp"
+#include "gpu.hpp"
+
+#define UPDATES 100
+
+static long allocations = 0;
+
+void *operator new(size_t n)
+{
+    void *p;
+
+    allocations++;
+    if ((p = malloc(n)) == NULL)
+        throw bad_alloc();
+
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+/*
+ * A steady-state update must not allocate
+ */
+int main()
+{
+    long before;
+    int sv[2];
+
+    fake_create(2);
+    fake_add_context(0, getpid(), getpid());
+    fake_add_context(0, 1, 1);
+    fake_add_context(1, getpid(), getpid() + 1);
+    fake_gpu_memory(0, 300, {{getpid(), 200}, {1, 100}});
+    fake_gpu_memory(1, 50, {{getpid(), 50}});
+
+    mali_gpu gpu;
+
+    // The first updates size the buffers
+    gpu.update();
+    gpu.update();
+    CHECK(gpu.get_partitions().size() == 2);
+    CHECK(gpu.get_partitions()[0].get_processes().size() == 2);
+
+    before = allocations;
+    for (int i = 0; i < UPDATES; i++)
+        CHECK(gpu.update().empty());
+
+    cout << "operator new calls in " << UPDATES << " steady-state updates: " << allocations - before << endl;
+    CHECK(allocations == before);
+
+    // Nor when processes are tracked instead of listed
+    CHECK(socketpair(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0, sv) == 0);
+    CHECK(gpu.watch_processes(sv[1]) == 0);
+    gpu.update();
+    gpu.update();
+
+    before = allocations;
+    for (int i = 0; i < UPDATES; i++)
+        CHECK(gpu.update().empty());
+
+    cout << "operator new calls in " << UPDATES << " tracked steady-state updates: " << allocations - before << endl;
+    CHECK(allocations == before);
+
+    return EXIT_SUCCESS;
+}
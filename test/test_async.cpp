@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <fcntl.h>
+
+#include "async.hpp"
+#include "fake_tree.hpp"
+
+/*
+ * Refreshes complete with fresh values, callbacks run once each
+ */
+static void test_delivery()
+{
+    mali_refresh_result res;
+    promise<mali_refresh_result> p;
+    atomic<int> calls(0);
+
+    fake_create(2);
+
+    mali_async_gpu agpu;
+
+    res = agpu.refresh(chrono::milliseconds(5000)).get();
+    CHECK(!res.timed_out && res.stale == 0);
+    CHECK(res.epoch >= 1);
+    CHECK(res.partitions.size() == 2);
+    CHECK(res.partitions[1].status == MALI_STATUS_ACTIVE);
+    CHECK(res.partitions[1].slices.get_bits() == 0x2);
+
+    fake_write(string(MALI_CLASS_PATH) + "/mali1/device/power/runtime_status", "suspended\n");
+    agpu.refresh(chrono::milliseconds(5000), [&p, &calls](const mali_refresh_result& r) {
+        calls++;
+        p.set_value(r);
+    });
+
+    res = p.get_future().get();
+    CHECK(!res.timed_out && res.stale == 0);
+    CHECK(res.partitions[1].status == MALI_STATUS_SUSPENDED);
+    CHECK(calls == 1);
+    CHECK(agpu.get_timeouts(MALI_FIELD_STATUS) == 0);
+}
+
+/*
+ * A blocked read misses the deadline, its field is stale until the read
+ * returns
+ */
+static void test_deadline()
+{
+    string status = string(MALI_CLASS_PATH) + "/mali1/device/power/runtime_status";
+    string held = string(MALI_TEST_ROOT) + "/held_fifo";
+    mali_refresh_result res;
+    int fd;
+
+    fake_create(2);
+
+    mali_async_gpu agpu;
+
+    res = agpu.refresh(chrono::milliseconds(5000)).get();
+    CHECK(!res.timed_out);
+
+    // Opening a FIFO blocks until a writer shows up
+    remove(status.c_str());
+    CHECK(mkfifo(status.c_str(), 0644) == 0);
+    CHECK(link(status.c_str(), held.c_str()) == 0);
+
+    res = agpu.refresh(chrono::milliseconds(50)).get();
+    CHECK(res.timed_out);
+    CHECK(res.stale & MALI_FIELD_STATUS);
+    CHECK(res.partitions[1].stale & MALI_FIELD_STATUS);
+    CHECK(res.partitions[1].status == MALI_STATUS_ACTIVE);
+    CHECK(agpu.get_timeouts(MALI_FIELD_STATUS) == 1);
+
+    // Put the file back, then release the blocked read
+    fake_write(status + ".tmp", "suspended\n");
+    CHECK(rename((status + ".tmp").c_str(), status.c_str()) == 0);
+    CHECK((fd = open(held.c_str(), O_WRONLY)) >= 0);
+    CHECK(write(fd, "suspended\n", 10) == 10);
+    close(fd);
+
+    res = agpu.refresh(chrono::milliseconds(5000)).get();
+    CHECK(!res.timed_out && res.stale == 0);
+    CHECK(res.partitions[1].status == MALI_STATUS_SUSPENDED);
+    CHECK(agpu.get_timeouts(MALI_FIELD_STATUS) == 1);
+}
+
+/*
+ * The destructor waits for a callback in progress
+ */
+static void test_destroy()
+{
+    atomic<bool> started(false), finished(false);
+
+    fake_create(1);
+
+    {
+        mali_async_gpu agpu;
+
+        agpu.refresh(chrono::milliseconds(5000), [&started, &finished](const mali_refresh_result&) {
+            struct timespec ts = {0, 100000000};
+
+            started = true;
+            nanosleep(&ts, NULL);
+            finished = true;
+        });
+
+        while (!started)
+            this_thread::yield();
+    }
+
+    CHECK(finished);
+}
+
+int main()
+{
+    test_delivery();
+    test_deadline();
+    test_destroy();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <set>
+#include <sys/wait.h>
+
+#include "fake_tree.hpp"
+#include "fleet.hpp"
+#include "gpu.hpp"
+
+#define NODES 3
+#define TIMEOUT_MS 5000
+
+static const string sock_addr = string("unix:") + MALI_TEST_ROOT + "/fleet.sock";
+
+/*
+ * Stand-in node: streams one sample of the synthetic GPU as node name,
+ * then keeps its connection until fd is closed
+ */
+static void run_node(const string& name, int fd)
+{
+    mali_gpu gpu;
+    mali_fleet_sender sender(sock_addr, name);
+    char c;
+
+    if (sender.send(gpu))
+        exit(EXIT_FAILURE);
+    while (read(fd, &c, 1) > 0)
+        ;
+    exit(EXIT_SUCCESS);
+}
+
+/*
+ * Runs the aggregator until cond holds, or fails after TIMEOUT_MS
+ */
+template <class F> static void run_until(mali_fleet_aggregator& agg, F cond)
+{
+    for (int i = 0; !cond(); i += 10)
+    {
+        CHECK(i < TIMEOUT_MS);
+        CHECK(agg.run(10) >= 0);
+    }
+}
+
+/*
+ * Nodes stream to an aggregator, which merges them
+ */
+static void test_nodes()
+{
+    mali_fleet_aggregator agg;
+    vector<mali_fleet_process> top;
+    set<string> names;
+    pid_t nodes[NODES];
+    int pipefd[2];
+    int status;
+
+    CHECK(agg.listen(sock_addr) == 0);
+    CHECK(pipe(pipefd) == 0);
+
+    for (int i = 0; i < NODES; i++)
+    {
+        if ((nodes[i] = fork()) == 0)
+        {
+            close(pipefd[1]);
+            run_node("node" + to_string(i), pipefd[0]);
+        }
+        CHECK(nodes[i] > 0);
+    }
+    close(pipefd[0]);
+
+    run_until(agg, [&]() { return agg.get_nodes().size() == NODES; });
+
+    for (const map<string, mali_fleet_node>::value_type& i : agg.get_nodes())
+    {
+        CHECK(i.second.connected);
+        CHECK(i.second.partitions.size() == 2);
+        CHECK(i.second.processes.size() == 2);
+    }
+    CHECK(agg.get_memory_usage() == NODES * agg.get_nodes().begin()->second.memory_usage);
+    CHECK(agg.get_memory_usage() > 0);
+    CHECK(agg.get_headroom() == agg.get_system_memory() - agg.get_memory_usage());
+    CHECK(agg.get_partitions().size() == 2 * NODES);
+
+    // mali1 of each node is suspended
+    for (const mali_fleet_partition& i : agg.get_non_active_partitions())
+        CHECK(strcmp(i.partition->partition_name, "mali1") == 0);
+    CHECK(agg.get_non_active_partitions().size() == NODES);
+
+    // The largest process of each node comes first
+    top = agg.get_top_processes(NODES);
+    CHECK(top.size() == NODES);
+    for (const mali_fleet_process& i : top)
+    {
+        CHECK(i.process->pid == getpid() && i.process->memory_usage == top[0].process->memory_usage);
+        names.insert(i.node->name);
+    }
+    CHECK(names.size() == NODES);
+    CHECK(agg.get_top_processes(100).size() == 2 * NODES);
+
+    // Nodes going away are kept, but no longer counted
+    close(pipefd[1]);
+    for (int i = 0; i < NODES; i++)
+    {
+        CHECK(waitpid(nodes[i], &status, 0) == nodes[i]);
+        CHECK(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS);
+    }
+    run_until(agg, [&]() { return agg.get_connection_count() == 0; });
+    CHECK(agg.get_nodes().size() == NODES);
+    CHECK(agg.get_memory_usage() == 0 && agg.get_partitions().empty());
+}
+
+/*
+ * A sender retries at most every MALI_FLEET_RETRY_MS
+ */
+static void test_retry()
+{
+    struct timespec ts = {MALI_FLEET_RETRY_MS / 1000, (MALI_FLEET_RETRY_MS % 1000) * 1000000};
+    mali_fleet_sender sender(sock_addr, "node");
+    mali_fleet_aggregator agg;
+    mali_gpu gpu;
+
+    unlink(sock_addr.c_str() + 5);
+    CHECK(sender.send(gpu) != 0);
+
+    CHECK(agg.listen(sock_addr) == 0);
+    CHECK(sender.send(gpu) != 0);
+    CHECK(!sender.is_connected());
+
+    nanosleep(&ts, NULL);
+    CHECK(sender.send(gpu) == 0);
+    run_until(agg, [&]() { return agg.get_nodes().size() == 1; });
+}
+
+/*
+ * A node name is held by the latest connection sending it, a connection
+ * it was taken from going away leaves the node connected
+ */
+static void test_same_name()
+{
+    mali_fleet_aggregator agg;
+    mali_gpu gpu;
+    uint64_t received;
+
+    unlink(sock_addr.c_str() + 5);
+    CHECK(agg.listen(sock_addr) == 0);
+
+    mali_fleet_sender *first = new mali_fleet_sender(sock_addr, "node");
+    CHECK(first->send(gpu) == 0);
+    run_until(agg, [&]() { return agg.get_nodes().size() == 1; });
+    received = agg.get_nodes().at("node").received;
+
+    {
+        mali_fleet_sender second(sock_addr, "node");
+
+        CHECK(second.send(gpu) == 0);
+        run_until(agg, [&]() { return agg.get_nodes().at("node").received != received; });
+        CHECK(agg.get_connection_count() == 1);
+        CHECK(agg.get_nodes().at("node").connected);
+
+        // The first connection was dropped
+        delete first;
+        CHECK(agg.run(50) >= 0);
+        CHECK(agg.get_nodes().at("node").connected);
+        CHECK(agg.get_memory_usage() > 0);
+    }
+
+    run_until(agg, [&]() { return agg.get_connection_count() == 0; });
+    CHECK(!agg.get_nodes().at("node").connected);
+}
+
+/*
+ * A frame not taken by the aggregator fails the send within
+ * MALI_FLEET_SEND_TIMEOUT_MS, and closes the connection
+ */
+static void test_send_timeout()
+{
+    mali_fleet_aggregator agg;
+    mali_gpu gpu;
+    struct timespec start, end;
+    uint64_t elapsed;
+    int rc = 0, i;
+
+    unlink(sock_addr.c_str() + 5);
+    CHECK(agg.listen(sock_addr) == 0);
+
+    mali_fleet_sender sender(sock_addr, "node");
+
+    // The aggregator does not run, the socket buffers fill up
+    for (i = 0; i < 100000 && rc == 0; i++)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        rc = sender.send(gpu);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+    }
+
+    elapsed = (end.tv_sec - start.tv_sec) * 1000ULL + end.tv_nsec / 1000000 - start.tv_nsec / 1000000;
+    CHECK(rc != 0 && !sender.is_connected());
+    CHECK(elapsed >= MALI_FLEET_SEND_TIMEOUT_MS - 10 && elapsed < MALI_FLEET_SEND_TIMEOUT_MS + 500);
+}
+
+/*
+ * Listening on a path that is not a socket fails and leaves it alone
+ */
+static void test_listen_path()
+{
+    string path = string(MALI_TEST_ROOT) + "/fleet.txt";
+    mali_fleet_aggregator agg;
+    ifstream in;
+    string s;
+
+    fake_write(path, "keep\n");
+    CHECK(agg.listen("unix:" + path) != 0);
+
+    in.open(path);
+    CHECK(getline(in, s) && s == "keep");
+}
+
+int main()
+{
+    fake_create(2);
+    fake_write(string(MALI_CLASS_PATH) + "/mali1/device/power/runtime_status", "suspended\n");
+    fake_add_context(0, getpid(), getpid());
+    fake_add_context(1, 1, 1);
+    fake_gpu_memory(0, 300, {{getpid(), 300}});
+    fake_gpu_memory(1, 50, {{1, 50}});
+
+    test_nodes();
+    test_retry();
+    test_same_name();
+    test_send_timeout();
+    test_listen_path();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cmath>
+#include <cstdlib>
+
+#include "fake_tree.hpp"
+#include "gpu.hpp"
+#include "pm.hpp"
+
+/*
+ * Returns a sample at t ms, the partition being active a fraction duty
+ * of the time since 0
+ */
+static mali_pm_sample sample(uint64_t t, double duty)
+{
+    mali_pm_sample s;
+
+    s.timestamp = t;
+    s.active_time = (uint64_t)(t * duty);
+    s.suspended_time = t - s.active_time;
+    s.status = MALI_STATUS_ACTIVE;
+    s.valid = true;
+
+    return s;
+}
+
+/*
+ * The default window is covered whatever the sampling period
+ */
+static void test_window(uint64_t period)
+{
+    mali_pm_history h;
+    mali_duty_cycle d;
+
+    for (uint64_t t = 0; t <= 20000; t += period)
+        h.add(sample(t, 0.3));
+
+    d = h.get_duty_cycle(MALI_PM_WINDOW_MS);
+    CHECK(d.valid);
+    CHECK(d.window >= MALI_PM_WINDOW_MS - MALI_PM_MIN_PERIOD_MS && d.window <= MALI_PM_WINDOW_MS);
+    CHECK(fabs(d.duty_cycle - 0.3) < 0.01);
+
+    // Shorter windows too
+    d = h.get_duty_cycle(2000);
+    CHECK(d.valid);
+    CHECK(d.window >= 2000 - MALI_PM_MIN_PERIOD_MS && d.window <= 2000);
+}
+
+/*
+ * Counters that do not advance give no duty cycle, restarted counters
+ * restart the history
+ */
+static void test_counters()
+{
+    mali_pm_history h;
+    mali_pm_sample s = sample(1000, 0.5);
+
+    CHECK(!h.get_duty_cycle(MALI_PM_WINDOW_MS).valid);
+
+    h.add(s);
+    s.timestamp += 500;
+    h.add(s);
+    CHECK(!h.get_duty_cycle(MALI_PM_WINDOW_MS).valid);
+
+    s.timestamp += 500;
+    s.active_time += 250;
+    s.suspended_time += 250;
+    h.add(s);
+    CHECK(h.get_duty_cycle(MALI_PM_WINDOW_MS).valid);
+    CHECK(h.get_duty_cycle(MALI_PM_WINDOW_MS).duty_cycle == 0.5);
+
+    // Since the device was probed again
+    s.timestamp += 500;
+    s.active_time = 100;
+    s.suspended_time = 300;
+    h.add(s);
+    CHECK(h.get_duty_cycle(MALI_PM_WINDOW_MS).duty_cycle == 0.25);
+}
+
+/*
+ * Duty cycle and transitions of a partition from synthetic counter files
+ */
+static void test_partition()
+{
+    struct timespec ts = {0, MALI_PM_MIN_PERIOD_MS * 1000000};
+    mali_duty_cycle d;
+
+    fake_create(1);
+    fake_pm_counters(0, 1000, 1000);
+
+    mali_gpu gpu(MALI_FIELD_STATUS | MALI_FIELD_PM_COUNTERS);
+
+    nanosleep(&ts, NULL);
+    gpu.update();
+    CHECK(!gpu.get_partitions()[0].get_duty_cycle().valid);
+
+    fake_pm_counters(0, 1060, 1040);
+    fake_write(string(MALI_CLASS_PATH) + "/mali0/device/power/runtime_status", "suspended\n");
+    nanosleep(&ts, NULL);
+    gpu.update();
+
+    d = gpu.get_partitions()[0].get_duty_cycle();
+    CHECK(d.valid);
+    CHECK(d.active_time == 60 && d.suspended_time == 40);
+    CHECK(fabs(d.duty_cycle - 0.6) < 1e-9);
+    CHECK(d.suspends == 1 && d.resumes == 0);
+}
+
+int main()
+{
+    test_window(MALI_PM_MIN_PERIOD_MS);
+    test_window(10);
+    test_window(1000);
+    test_counters();
+    test_partition();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <csignal>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "fake_tree.hpp"
+#include "gpu.hpp"
+
+static const string ctx = string(MALI_DBG_PATH) + "/mali0/ctx/";
+
+/*
+ * Closes context name of partition mali0. The directory is moved away
+ * rather than removed, for its inode not to be reused by the next one as
+ * it could be on disk file systems, but not on debugfs.
+ */
+static void close_context(const string& name)
+{
+    CHECK(rename((ctx + name).c_str(), (string(MALI_TEST_ROOT) + "/closed_" + name).c_str()) == 0);
+}
+
+/*
+ * A process keeps its identity while one of its contexts remains, a PID
+ * whose contexts were all replaced is another process
+ */
+static void test_identity()
+{
+    pid_t pid = getpid();
+
+    fake_create(1);
+    fake_add_context(0, pid, 1);
+
+    mali_gpu gpu(MALI_FIELD_PROCESSES);
+
+    // A second context, then the first one goes
+    fake_add_context(0, pid, 2);
+    CHECK(gpu.update().empty());
+    close_context(to_string(pid) + "_1");
+    CHECK(gpu.update().empty());
+    CHECK(gpu.get_partitions()[0].get_processes().size() == 1);
+
+    // All contexts replaced between updates
+    close_context(to_string(pid) + "_2");
+    fake_add_context(0, pid, 3);
+    const mali_change_set& changes = gpu.update();
+    CHECK(changes.count(MALI_CHANGE_PROCESS_EXITED) == 1);
+    CHECK(changes.count(MALI_CHANGE_PROCESS_ARRIVED) == 1);
+    CHECK(gpu.update().empty());
+}
+
+/*
+ * Forks a child that execs sleep once fd is written
+ */
+static pid_t fork_exec(int fd[2])
+{
+    pid_t pid;
+    char c;
+
+    CHECK(pipe(fd) == 0);
+    if ((pid = fork()) == 0)
+    {
+        close(fd[1]);
+        if (read(fd[0], &c, 1) == 1)
+            execlp("sleep", "sleep", "30", (char *)NULL);
+        _exit(EXIT_FAILURE);
+    }
+    CHECK(pid > 0);
+    close(fd[0]);
+
+    return pid;
+}
+
+/*
+ * Makes child pid exec, returns once its command line changed
+ */
+static void exec_child(pid_t pid, int fd[2])
+{
+    struct timespec ts = {0, 1000000};
+    string path = "/proc/" + to_string(pid) + "/cmdline";
+    string cmd;
+
+    CHECK(write(fd[1], "x", 1) == 1);
+    close(fd[1]);
+
+    for (int i = 0; i < 5000 && cmd.compare(0, 5, "sleep") != 0; i++)
+    {
+        nanosleep(&ts, NULL);
+        ifstream(path) >> cmd;
+    }
+    CHECK(cmd.compare(0, 5, "sleep") == 0);
+}
+
+/*
+ * Returns the command of process pid in partition mali0
+ */
+static string cmd_of(mali_gpu& gpu, pid_t pid)
+{
+    gpu.get_partitions()[0].get_processes();
+    mali_process *p = gpu.get_partitions()[0].find_process(pid);
+
+    CHECK(p != NULL);
+
+    return p->get_cmd();
+}
+
+/*
+ * A process exec'ing without releasing its context shows its new command
+ * after the next rescan
+ */
+static void test_cmd_rescan()
+{
+    struct timespec ts = {0, 2000000};
+    int fd[2];
+    pid_t child = fork_exec(fd);
+
+    fake_create(1);
+    fake_add_context(0, child, 1);
+
+    mali_gpu gpu(MALI_FIELD_PROCESSES | MALI_FIELD_PROCESS_CMD);
+
+    gpu.set_rescan_interval(0);
+    CHECK(cmd_of(gpu, child).find("test_processes") != string::npos);
+
+    exec_child(child, fd);
+    gpu.update();
+    CHECK(cmd_of(gpu, child).find("test_processes") != string::npos);
+
+    gpu.set_rescan_interval(1);
+    nanosleep(&ts, NULL);
+    CHECK(gpu.update().empty());
+    CHECK(cmd_of(gpu, child) == "sleep 30");
+
+    kill(child, SIGKILL);
+    waitpid(child, NULL, 0);
+}
+
+/*
+ * Sends the proc connector event of process pid exec'ing on sock
+ */
+static void send_exec(int sock, pid_t pid)
+{
+    char buf[NLMSG_SPACE(sizeof(cn_msg) + sizeof(proc_event))];
+    struct nlmsghdr nlh;
+    struct cn_msg cn;
+    struct proc_event ev;
+
+    memset(buf, 0, sizeof(buf));
+    memset(&nlh, 0, sizeof(nlh));
+    memset(&cn, 0, sizeof(cn));
+    memset(&ev, 0, sizeof(ev));
+    nlh.nlmsg_len = NLMSG_LENGTH(sizeof(cn) + sizeof(ev));
+    nlh.nlmsg_type = NLMSG_DONE;
+    cn.id.idx = CN_IDX_PROC;
+    cn.id.val = CN_VAL_PROC;
+    cn.len = sizeof(ev);
+    ev.what = proc_event::PROC_EVENT_EXEC;
+    ev.event_data.exec.process_pid = ev.event_data.exec.process_tgid = pid;
+    memcpy(buf, &nlh, sizeof(nlh));
+    memcpy(buf + NLMSG_HDRLEN, &cn, sizeof(cn));
+    memcpy(buf + NLMSG_HDRLEN + sizeof(cn), &ev, sizeof(ev));
+
+    CHECK(send(sock, buf, nlh.nlmsg_len, 0) == (ssize_t)nlh.nlmsg_len);
+}
+
+/*
+ * With process events, a listed process exec'ing shows its new command
+ * on the next update
+ */
+static void test_cmd_exec()
+{
+    int fd[2], sv[2];
+    pid_t child = fork_exec(fd);
+
+    fake_create(1);
+    fake_add_context(0, child, 1);
+    CHECK(socketpair(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0, sv) == 0);
+
+    mali_gpu gpu(MALI_FIELD_PROCESSES | MALI_FIELD_PROCESS_CMD);
+
+    gpu.set_rescan_interval(0);
+    CHECK(gpu.watch_processes(sv[1]) == 0);
+    CHECK(cmd_of(gpu, child).find("test_processes") != string::npos);
+
+    // Another process exec'ing changes nothing
+    send_exec(sv[0], getpid());
+    gpu.update();
+    CHECK(cmd_of(gpu, child).find("test_processes") != string::npos);
+
+    exec_child(child, fd);
+    send_exec(sv[0], child);
+    CHECK(gpu.update().empty());
+    CHECK(cmd_of(gpu, child) == "sleep 30");
+    CHECK(gpu.get_process_index().find_cmd("sleep 30").size() == 1);
+
+    kill(child, SIGKILL);
+    waitpid(child, NULL, 0);
+    close(sv[0]);
+    close(sv[1]);
+}
+
+/*
+ * A process filtered out by its command shows up once it exec'd into a
+ * matching one, from its exec event or on the next rescan
+ */
+static void test_filter_exec(bool events)
+{
+    struct timespec ts = {0, 2000000};
+    mali_filter filter(MALI_FIELD_PROCESSES | MALI_FIELD_PROCESS_CMD);
+    int fd[2], sv[2];
+    pid_t child = fork_exec(fd);
+
+    fake_create(1);
+    fake_add_context(0, child, 1);
+    CHECK(socketpair(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0, sv) == 0);
+    filter.add_cmd("sleep*");
+
+    mali_gpu gpu(filter);
+
+    gpu.set_rescan_interval(0);
+    if (events)
+        CHECK(gpu.watch_processes(sv[1]) == 0);
+    CHECK(gpu.get_partitions()[0].get_processes().empty());
+
+    exec_child(child, fd);
+    if (events)
+        send_exec(sv[0], child);
+    else
+    {
+        CHECK(gpu.update().empty());
+        gpu.set_rescan_interval(1);
+        nanosleep(&ts, NULL);
+    }
+    CHECK(gpu.update().size() == 1);
+    CHECK(cmd_of(gpu, child) == "sleep 30");
+
+    kill(child, SIGKILL);
+    waitpid(child, NULL, 0);
+    close(sv[0]);
+    close(sv[1]);
+}
+
+int main()
+{
+    test_identity();
+    test_cmd_rescan();
+    test_cmd_exec();
+    test_filter_exec(true);
+    test_filter_exec(false);
+
+    return EXIT_SUCCESS;
+}
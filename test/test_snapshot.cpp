@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include "fake_tree.hpp"
+#include "gpu.hpp"
+#include "snapshot.hpp"
+
+#define READS 10000
+
+/*
+ * Returns the region of shared memory segment name, mapped for writing
+ * behind the back of the writer
+ */
+static mali_snapshot_region *map_region(const string& name)
+{
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    void *addr;
+
+    CHECK(fd >= 0);
+    addr = mmap(NULL, sizeof(mali_snapshot_region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    CHECK(addr != MAP_FAILED);
+
+    return static_cast<mali_snapshot_region *>(addr);
+}
+
+/*
+ * A published snapshot reads back whole and by partition
+ */
+static void test_publish(const string& name)
+{
+    mali_gpu gpu;
+    mali_snapshot_writer writer(name);
+    mali_snapshot_data *data = new mali_snapshot_data();
+    mali_snapshot_partition part;
+    uint64_t system_memory = 0;
+
+    CHECK(writer.is_open());
+    writer.publish(gpu);
+
+    mali_snapshot_reader reader(name);
+
+    CHECK(reader.is_open());
+    CHECK(reader.read(*data));
+    CHECK(data->partition_count == 2 && data->process_count == 2);
+    CHECK(strcmp(data->partitions[1].partition_name, "mali1") == 0);
+    CHECK(data->memory_usage == gpu.get_memory_usage());
+
+    CHECK(reader.read_partition("mali1", part, &system_memory));
+    CHECK(part.memory_usage == data->partitions[1].memory_usage);
+    CHECK(system_memory == data->system_memory);
+    CHECK(!reader.read_partition("mali7", part));
+
+    delete data;
+}
+
+/*
+ * A snapshot being written is not read
+ */
+static void test_odd(const string& name)
+{
+    mali_snapshot_region *region = map_region(name);
+    mali_snapshot_reader reader(name);
+    mali_snapshot_data *data = new mali_snapshot_data();
+    mali_snapshot_partition part;
+    uint64_t seq = region->sequence.load();
+
+    CHECK(reader.is_open());
+    region->sequence.store(seq | 1);
+    CHECK(!reader.read(*data));
+    CHECK(!reader.read_partition("mali0", part));
+
+    region->sequence.store((seq | 1) + 1);
+    CHECK(reader.read(*data));
+    CHECK(reader.read_partition("mali0", part));
+
+    munmap(region, sizeof(mali_snapshot_region));
+    delete data;
+}
+
+/*
+ * Snapshots read while another thread keeps writing are never torn: each
+ * write sets all memory fields to the same value, with all processes used
+ * so that reads take long enough to overlap writes
+ */
+static void test_torn(const string& name)
+{
+    mali_snapshot_region *region = map_region(name);
+    mali_snapshot_reader reader(name);
+    mali_snapshot_data *data = new mali_snapshot_data();
+    mali_snapshot_partition part;
+    atomic<bool> stop(false);
+    uint64_t system_memory;
+    int reads = 0;
+
+    // The published snapshot is consistent in that sense
+    region->data.system_memory = 0;
+    region->data.memory_usage = 0;
+    region->data.process_count = MALI_SNAPSHOT_MAX_PROCESSES;
+    for (uint32_t i = 0; i < region->data.partition_count; i++)
+        region->data.partitions[i].memory_usage = 0;
+    for (uint32_t i = 0; i < MALI_SNAPSHOT_MAX_PROCESSES; i++)
+        region->data.processes[i].memory_usage = 0;
+
+    thread writer([region, &stop]()
+    {
+        for (uint64_t v = 1; !stop.load(); v++)
+        {
+            uint64_t seq = region->sequence.load(memory_order_relaxed) | 1;
+
+            region->sequence.store(seq, memory_order_relaxed);
+            atomic_thread_fence(memory_order_release);
+            region->data.system_memory = v;
+            region->data.memory_usage = v;
+            for (uint32_t i = 0; i < region->data.partition_count; i++)
+                region->data.partitions[i].memory_usage = v;
+            for (uint32_t i = 0; i < MALI_SNAPSHOT_MAX_PROCESSES; i++)
+                region->data.processes[i].memory_usage = v;
+            region->sequence.store(seq + 1, memory_order_release);
+        }
+    });
+
+    for (int i = 0; i < READS; i++)
+    {
+        if (reader.read(*data))
+        {
+            CHECK(data->memory_usage == data->system_memory);
+            for (uint32_t j = 0; j < data->partition_count; j++)
+                CHECK(data->partitions[j].memory_usage == data->system_memory);
+            for (uint32_t j = 0; j < data->process_count; j++)
+                CHECK((uint64_t)data->processes[j].memory_usage == data->system_memory);
+            reads++;
+        }
+        if (reader.read_partition("mali1", part, &system_memory))
+        {
+            CHECK(part.memory_usage == system_memory);
+            reads++;
+        }
+    }
+
+    stop.store(true);
+    writer.join();
+    munmap(region, sizeof(mali_snapshot_region));
+    delete data;
+
+    cout << reads << " consistent reads out of " << 2 * READS << endl;
+    CHECK(reads > 0);
+}
+
+int main()
+{
+    string name = "/mali_test_snapshot_" + to_string(getpid());
+
+    fake_create(2);
+    fake_add_context(0, getpid(), getpid());
+    fake_add_context(1, 1, 1);
+    fake_gpu_memory(0, 300, {{getpid(), 300}});
+    fake_gpu_memory(1, 50, {{1, 50}});
+
+    test_publish(name);
+    test_odd(name);
+    test_torn(name);
+
+    shm_unlink(name.c_str());
+
+    return EXIT_SUCCESS;
+}
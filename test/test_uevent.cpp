@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2024 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/socket.h>
+
+#include "fake_tree.hpp"
+#include "uevent.hpp"
+
+/*
+ * Sends a uevent of action on device dev of subsystem, keys are NUL
+ * separated as the kernel sends them
+ */
+static void send_event(int sock, const string& action, const string& subsystem, const string& dev)
+{
+    string devpath = "/devices/virtual/" + subsystem + "/" + dev;
+    string msg = action + "@" + devpath + '\0' + "ACTION=" + action + '\0' + "DEVPATH=" + devpath + '\0'
+                 + "SUBSYSTEM=" + subsystem + '\0' + "SEQNUM=1" + '\0';
+
+    CHECK(send(sock, msg.data(), msg.size(), 0) == (ssize_t)msg.size());
+}
+
+/*
+ * Sends raw bytes as one datagram
+ */
+static void send_raw(int sock, const string& msg)
+{
+    CHECK(send(sock, msg.data(), msg.size(), 0) == (ssize_t)msg.size());
+}
+
+/*
+ * Mali devices added or removed are reported, other events are not
+ */
+static void test_events(int *sv)
+{
+    mali_uevent_listener l(sv[0]);
+
+    CHECK(l.is_open());
+    CHECK(!l.poll());
+
+    send_event(sv[1], "add", "misc", "mali0");
+    CHECK(l.poll());
+    CHECK(!l.poll());
+
+    send_event(sv[1], "remove", "misc", "mali1");
+    CHECK(l.poll());
+
+    // Other actions, subsystems and devices
+    send_event(sv[1], "change", "misc", "mali0");
+    send_event(sv[1], "add", "drm", "mali0");
+    send_event(sv[1], "add", "misc", "fuse");
+    CHECK(!l.poll());
+
+    // Several pending events are drained at once
+    send_event(sv[1], "add", "drm", "card0");
+    send_event(sv[1], "add", "misc", "mali2");
+    send_event(sv[1], "add", "misc", "fuse");
+    CHECK(l.poll());
+    CHECK(!l.poll());
+}
+
+/*
+ * Datagrams cut short are ignored, ones larger than the buffer may hide
+ * a Mali event and are reported
+ */
+static void test_truncated(int *sv)
+{
+    mali_uevent_listener l(sv[0]);
+    string msg = string("add@/devices/virtual/misc/mali0") + '\0' + "ACTION=add" + '\0'
+                 + "DEVPATH=/devices/virtual/misc/mali0" + '\0' + "SUBSYSTEM=mi";
+
+    // Last key without its NUL, nor its full value
+    send_raw(sv[1], msg);
+    send_raw(sv[1], "ACTION=add");
+    CHECK(!l.poll());
+
+    msg = string("add@/devices/virtual/misc/mali0") + '\0' + "ACTION=add" + '\0'
+          + "DEVPATH=/devices/virtual/misc/mali0" + '\0' + "PAD=" + string(MALI_UEVENT_BUFFER_SIZE, 'x') + '\0'
+          + "SUBSYSTEM=misc" + '\0';
+    send_raw(sv[1], msg);
+    CHECK(l.poll());
+    CHECK(!l.poll());
+}
+
+int main()
+{
+    int sv[2];
+
+    CHECK(socketpair(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0, sv) == 0);
+
+    test_events(sv);
+    test_truncated(sv);
+
+    // An injected socket is left open
+    CHECK(fcntl(sv[0], F_GETFD) >= 0);
+    close(sv[0]);
+    close(sv[1]);
+
+    return EXIT_SUCCESS;
+}